@@ -0,0 +1,90 @@
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "argsort.h"
+#include "gsort.h"
+
+#define ARGSORT_NARROW_MAX ((int64_t)1 << 32) // Largest size whose indices fit the low half of a word
+
+typedef struct
+{
+    const int *keys;
+    ptrdiff_t *order;
+    uint64_t *narrow; // Key with the sign bit flipped in the high half, index in the low half
+    KeyPayload *wide; // Key and index side by side, past ARGSORT_NARROW_MAX
+    ptrdiff_t size;
+    int parts;
+} ArgsortShared;
+
+static ptrdiff_t part_start(ArgsortShared *shared, int part)
+{
+    return shared->size * part / shared->parts;
+}
+
+// Flipping the sign bit makes unsigned order match int order, and the index
+// below it breaks ties, so plain uint64 order is the stable key order
+static void pack_part(void *arg, int part)
+{
+    ArgsortShared *shared = (ArgsortShared *)arg;
+    ptrdiff_t end = part_start(shared, part + 1);
+    for (ptrdiff_t i = part_start(shared, part); i < end; i++)
+    {
+        if (shared->narrow != NULL)
+            shared->narrow[i] = (uint64_t)((uint32_t)shared->keys[i] ^ 0x80000000u) << 32 | (uint64_t)i;
+        else
+            shared->wide[i] = (KeyPayload){shared->keys[i], i};
+    }
+}
+
+static void unpack_part(void *arg, int part)
+{
+    ArgsortShared *shared = (ArgsortShared *)arg;
+    ptrdiff_t end = part_start(shared, part + 1);
+    for (ptrdiff_t i = part_start(shared, part); i < end; i++)
+    {
+        if (shared->narrow != NULL)
+            shared->order[i] = (ptrdiff_t)(uint32_t)shared->narrow[i];
+        else
+            shared->order[i] = (ptrdiff_t)shared->wide[i].payload;
+    }
+}
+
+// Run one pass over every part, on the pool if there is one
+static void for_each_part(SortPool *pool, ArgsortShared *shared, void (*run)(void *arg, int part))
+{
+    if (pool != NULL)
+        pool_parallel_for(pool, shared->parts, run, shared);
+    else
+        run(shared, 0);
+}
+
+int pool_argsort(SortPool *pool, const int *keys, ptrdiff_t size, ptrdiff_t *order)
+{
+    if (size < 1)
+        return 0;
+
+    ArgsortShared shared;
+    shared.keys = keys;
+    shared.order = order;
+    shared.size = size;
+    shared.parts = pool != NULL ? pool_size(pool) : 1;
+    shared.narrow = NULL;
+    shared.wide = NULL;
+    if (size <= ARGSORT_NARROW_MAX)
+        shared.narrow = (uint64_t *)malloc((size_t)size * sizeof(uint64_t));
+    else
+        shared.wide = (KeyPayload *)malloc((size_t)size * sizeof(KeyPayload));
+    if (shared.narrow == NULL && shared.wide == NULL)
+        return -1;
+
+    for_each_part(pool, &shared, pack_part);
+    if (shared.narrow != NULL)
+        gsort_uint64(pool, shared.narrow, size);
+    else
+        gsort_key_payload_stable(pool, shared.wide, size);
+    for_each_part(pool, &shared, unpack_part);
+
+    free(shared.narrow);
+    free(shared.wide);
+    return 0;
+}
@@ -0,0 +1,17 @@
+#ifndef ARGSORT_H
+#define ARGSORT_H
+
+#include <stddef.h>
+
+#include "pool.h"
+
+// Argsort: fill order[0..size-1] with the permutation that sorts keys, so that
+// keys[order[0]] <= keys[order[1]] <= ..., without moving the keys. Equal keys
+// keep their index order. Each key is packed next to its index and the pairs are
+// sorted as records by the gsort engines, so no comparison chases an index into
+// the key array. Up to 2^32 keys a pair is one 64-bit word, beyond that a
+// 16-byte KeyPayload. pool may be NULL to sort in the caller.
+// Returns 0, or -1 if the pairs do not fit in memory.
+int pool_argsort(SortPool *pool, const int *keys, ptrdiff_t size, ptrdiff_t *order);
+
+#endif
@@ -0,0 +1,622 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <stdint.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "pool.h"
+#include "partition.h"
+#include "vpartition.h"
+#include "gen.h"
+#include "msort.h"
+#include "ssort.h"
+#include "rsort.h"
+#include "argsort.h"
+#include "select.h"
+#include "verify.h"
+#include "numa.h"
+#include "profile.h"
+#include "tune.h"
+
+// Benchmark driver for every sort engine. Times are wall clock (CLOCK_MONOTONIC),
+// so parallel speedup shows up; clock() sums CPU time over all threads.
+//
+//   ./bench --engine pool --kernel vector --size 2^20,2^25 --threads 8 --reps 10
+//
+// The NUMA topology and mode, and the ISA of the vector kernel, go to stderr
+// first; --numa places the arrays across the nodes and pins the pool's
+// workers (numa.h).
+//
+// Rows go to stdout or, with --output, are appended to a CSV in one of these schemas:
+//   bench      engine,kernel,pivot,dist,range,unique,array_size,threads,numa,threshold,reps,min,median,p95,elements_per_sec,split_balance
+//              (range, unique: --range, 0 for the default, and --unique; numa: --numa;
+//              split_balance: split_balance() over the timed runs, 1 = every split
+//              an even halving, empty for engines that do not partition)
+//   threshold  array_size,threshold,time         (threshold_v_time.csv, read by plot.py)
+//   partition  partition,array_size,sequential_time,parallel_time
+//              (partition.csv, turned into speedups by data.py for plot_partition.py)
+
+#define MAX_LIST 32 // Most sizes or thresholds in one run
+
+static const char benchHeader[] = "engine,kernel,pivot,dist,range,unique,array_size,threads,numa,threshold,reps,min,median,p95,elements_per_sec,split_balance\n";
+
+typedef struct
+{
+    const char *name;
+    void (*sort)(SortPool *pool, int *array, ptrdiff_t size);
+    int partial; // Only the topK smallest keys come out sorted, at the front
+} Engine;
+
+static ptrdiff_t topK = 1000; // k of the partial engines, from --topk
+
+static void sort_pool(SortPool *pool, int *array, ptrdiff_t size)
+{
+    pool_sort(pool, array, size);
+}
+
+static void sort_sequential(SortPool *pool, int *array, ptrdiff_t size)
+{
+    (void)pool;
+    sequential_quicksort(array, 0, size - 1);
+}
+
+static void sort_merge(SortPool *pool, int *array, ptrdiff_t size)
+{
+    pool_merge_sort(pool, array, size);
+}
+
+static void sort_sample(SortPool *pool, int *array, ptrdiff_t size)
+{
+    pool_sample_sort(pool, array, size);
+}
+
+static void sort_radix(SortPool *pool, int *array, ptrdiff_t size)
+{
+    pool_radix_sort(pool, array, size);
+}
+
+static void sort_radix_msd(SortPool *pool, int *array, ptrdiff_t size)
+{
+    pool_radix_sort_msd(pool, array, size);
+}
+
+// Argsort, then gather the keys through the permutation so the result can be
+// checked; the gather is part of the time, as it would be for a real column
+static void sort_argsort(SortPool *pool, int *array, ptrdiff_t size)
+{
+    ptrdiff_t *order = (ptrdiff_t *)malloc((size_t)size * sizeof(ptrdiff_t));
+    int *keys = (int *)malloc((size_t)size * sizeof(int));
+    if (order == NULL || keys == NULL || pool_argsort(pool, array, size, order) != 0)
+    {
+        fprintf(stderr, "bench: argsort out of memory at %td elements\n", size);
+        exit(1);
+    }
+    memcpy(keys, array, (size_t)size * sizeof(int));
+    for (ptrdiff_t i = 0; i < size; i++)
+        array[i] = keys[order[i]];
+    free(order);
+    free(keys);
+}
+
+// Smallest topK keys only; compare with pool to see what a full sort costs
+static void sort_topk(SortPool *pool, int *array, ptrdiff_t size)
+{
+    pool_partial_sort(pool, array, size, topK);
+}
+
+static int compare_ints(const void *a, const void *b)
+{
+    int x = *(const int *)a;
+    int y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+static void sort_libc(SortPool *pool, int *array, ptrdiff_t size)
+{
+    (void)pool;
+    qsort(array, size, sizeof(int), compare_ints);
+}
+
+static const Engine engines[] = {
+    {"pool", sort_pool, 0},
+    {"sequential", sort_sequential, 0},
+    {"merge", sort_merge, 0},
+    {"sample", sort_sample, 0},
+    {"radix", sort_radix, 0},
+    {"radix_msd", sort_radix_msd, 0},
+    {"argsort", sort_argsort, 0},
+    {"topk", sort_topk, 1},
+    {"qsort", sort_libc, 0},
+};
+#define ENGINE_COUNT (int)(sizeof(engines) / sizeof(engines[0]))
+
+typedef struct
+{
+    const Engine *engine;
+    GenOptions gen;
+    int threads;
+    int reps;
+    int warmup;
+    const char *schema;
+    const char *output;
+    int autotune;
+    ptrdiff_t sizes[MAX_LIST];
+    int sizeCount;
+    ptrdiff_t thresholds[MAX_LIST];
+    int thresholdCount;
+} BenchOptions;
+
+// Timing summary of one configuration
+typedef struct
+{
+    double min;
+    double median;
+    double p95;
+} Timing;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Sorted prefix of k keys, none of them greater than a key after it
+static int check_top_k(SortPool *pool, const int *array, ptrdiff_t size, ptrdiff_t k)
+{
+    if (k > size)
+        k = size;
+    if (find_unsorted(pool, array, k) >= 0)
+        return 0;
+    for (ptrdiff_t i = k; i < size; i++)
+    {
+        if (array[i] < array[k - 1])
+            return 0;
+    }
+    return 1;
+}
+
+// Regenerate and sort the input warmup times untimed, then reps times timed
+static Timing run(const BenchOptions *options, const Engine *engine, SortPool *pool, int *array, ptrdiff_t size)
+{
+    int total = options->warmup + options->reps;
+    double *times = (double *)malloc(options->reps * sizeof(double));
+
+    for (int r = 0; r < total; r++)
+    {
+        generate_input(array, size, &options->gen);
+        KeyHash input;
+        key_hash(pool, array, size, &input);
+        if (r == options->warmup)
+            reset_split_stats(); // The split balance covers the timed runs only
+        double start = now();
+        engine->sort(pool, array, size);
+        double elapsed = now() - start;
+
+        // Untimed: the order and the multiset hash, one parallel pass each
+        VerifyResult result;
+        if (engine->partial)
+        {
+            KeyHash output;
+            key_hash(pool, array, size, &output);
+            result = !check_top_k(pool, array, size, topK) ? VERIFY_UNSORTED
+                     : key_hash_equal(&input, &output)     ? VERIFY_OK
+                                                           : VERIFY_NOT_PERMUTATION;
+        }
+        else
+        {
+            result = verify_sort(pool, &input, array, size, NULL);
+        }
+        if (result == VERIFY_UNSORTED)
+        {
+            fprintf(stderr, "bench: %s left %td elements unsorted\n", engine->name, size);
+            exit(1);
+        }
+        if (result == VERIFY_NOT_PERMUTATION)
+        {
+            fprintf(stderr, "bench: %s lost or changed keys of %td elements\n", engine->name, size);
+            exit(1);
+        }
+        if (r >= options->warmup)
+            times[r - options->warmup] = elapsed;
+    }
+
+    // Insertion sort: reps is small
+    for (int i = 1; i < options->reps; i++)
+    {
+        double t = times[i];
+        int j = i - 1;
+        while (j >= 0 && times[j] > t)
+        {
+            times[j + 1] = times[j];
+            j--;
+        }
+        times[j + 1] = t;
+    }
+
+    Timing timing;
+    int n = options->reps;
+    timing.min = times[0];
+    timing.median = n % 2 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+    int p95 = (95 * n + 99) / 100 - 1; // Nearest rank
+    timing.p95 = times[p95 < 0 ? 0 : p95];
+    free(times);
+    return timing;
+}
+
+static int log2_of(ptrdiff_t size)
+{
+    int log = 0;
+    while (((ptrdiff_t)1 << (log + 1)) <= size)
+        log++;
+    return log;
+}
+
+// Parse "2^20" or a plain number in [min, max]
+static long long parse_number(const char *text, long long min, long long max)
+{
+    char *end;
+    long long value;
+    const char *digits = text;
+    if (strncmp(text, "2^", 2) == 0)
+    {
+        digits = text + 2;
+        long exponent = strtol(digits, &end, 10);
+        value = (exponent >= 0 && exponent < 63) ? 1LL << exponent : -1;
+    }
+    else
+    {
+        value = strtoll(text, &end, 10);
+    }
+    if (end == digits || *end != '\0' || value < min || value > max)
+    {
+        fprintf(stderr, "bench: bad count '%s'\n", text);
+        exit(2);
+    }
+    return value;
+}
+
+static int parse_count(const char *text)
+{
+    return (int)parse_number(text, 1, INT_MAX);
+}
+
+// Parse a comma-separated list of counts, each at most max
+static int parse_list(char *text, ptrdiff_t *values, long long max)
+{
+    int count = 0;
+    for (char *item = strtok(text, ","); item != NULL; item = strtok(NULL, ","))
+    {
+        if (count == MAX_LIST)
+        {
+            fprintf(stderr, "bench: at most %d values per list\n", MAX_LIST);
+            exit(2);
+        }
+        values[count++] = (ptrdiff_t)parse_number(item, 1, max);
+    }
+    return count;
+}
+
+static void usage(FILE *out)
+{
+    fprintf(out,
+            "usage: bench [options]\n"
+            "  --engine NAME      pool (default), sequential, merge, sample,\n"
+            "                     radix, radix_msd, argsort, topk, qsort\n"
+            "  --topk K           keys the topk engine sorts (default 1000)\n"
+            "  --kernel NAME      partition kernel (default hoare)\n"
+            "  --pivot NAME       pivot policy (default auto)\n"
+            "  --threshold LIST   pool threshold(s), e.g. 10000,100000\n"
+            "  --threads N        pool workers, 0 = one per core (default)\n"
+            "  --numa MODE        off (default), interleave or first_touch the arrays\n"
+            "                     across NUMA nodes and pin the workers\n"
+            "  --size LIST        array size(s), e.g. 2^20,2^25 (default 2^20)\n"
+            "  --dist NAME        uniform (default), sorted, reversed, sawtooth, organ_pipe,\n"
+            "                     zipf, few_unique, nearly_sorted, all_equal\n"
+            "  --range N          key range for uniform and zipf (default: full / size)\n"
+            "  --zipf S           Zipf exponent (default 1.0)\n"
+            "  --unique N         distinct keys for few_unique (default 16)\n"
+            "  --swaps P          percent of elements swapped by nearly_sorted (default 1)\n"
+            "  --run N            run length for sawtooth (default 4096)\n"
+            "  --reps N           timed repetitions (default 5)\n"
+            "  --warmup N         untimed runs first (default 1)\n"
+            "  --seed N           input seed (default 1)\n"
+            "  --schema NAME      bench (default), threshold, partition\n"
+            "  --output FILE      append rows to FILE instead of printing them\n"
+            "  --autotune         calibrate this host over --size and write its profile\n"
+            "                     (to --output, default sort_profile.<hostname>)\n");
+}
+
+static void parse_options(int argc, char **argv, BenchOptions *options)
+{
+    static const struct option longOptions[] = {
+        {"engine", required_argument, NULL, 'e'},
+        {"kernel", required_argument, NULL, 'k'},
+        {"pivot", required_argument, NULL, 'p'},
+        {"threshold", required_argument, NULL, 't'},
+        {"threads", required_argument, NULL, 'j'},
+        {"size", required_argument, NULL, 'n'},
+        {"dist", required_argument, NULL, 'd'},
+        {"reps", required_argument, NULL, 'r'},
+        {"warmup", required_argument, NULL, 'w'},
+        {"seed", required_argument, NULL, 's'},
+        {"range", required_argument, NULL, 'R'},
+        {"zipf", required_argument, NULL, 'z'},
+        {"unique", required_argument, NULL, 'u'},
+        {"swaps", required_argument, NULL, 'x'},
+        {"run", required_argument, NULL, 'l'},
+        {"schema", required_argument, NULL, 'S'},
+        {"output", required_argument, NULL, 'o'},
+        {"topk", required_argument, NULL, 'K'},
+        {"numa", required_argument, NULL, 'N'},
+        {"autotune", no_argument, NULL, 'a'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+
+    options->engine = &engines[0];
+    gen_default_options(&options->gen);
+    options->threads = 0;
+    options->reps = 5;
+    options->warmup = 1;
+    options->schema = "bench";
+    options->output = NULL;
+    options->autotune = 0;
+    options->sizes[0] = 1 << 20;
+    options->sizeCount = 1;
+    options->thresholdCount = 0;
+
+    int c, found;
+    while ((c = getopt_long(argc, argv, "", longOptions, NULL)) != -1)
+    {
+        switch (c)
+        {
+        case 'e':
+            found = 0;
+            for (int i = 0; i < ENGINE_COUNT; i++)
+            {
+                if (strcmp(optarg, engines[i].name) == 0)
+                {
+                    options->engine = &engines[i];
+                    found = 1;
+                }
+            }
+            if (!found)
+            {
+                fprintf(stderr, "bench: unknown engine '%s'\n", optarg);
+                exit(2);
+            }
+            break;
+        case 'N':
+            found = numa_mode_parse(optarg);
+            if (found < 0)
+            {
+                fprintf(stderr, "bench: unknown NUMA mode '%s'\n", optarg);
+                exit(2);
+            }
+            numaMode = (NumaMode)found;
+            break;
+        case 'k':
+            found = partition_kernel_parse(optarg);
+            if (found < 0)
+            {
+                fprintf(stderr, "bench: unknown kernel '%s'\n", optarg);
+                exit(2);
+            }
+            partitionKernel = (PartitionKernel)found;
+            break;
+        case 'p':
+            found = pivot_policy_parse(optarg);
+            if (found < 0)
+            {
+                fprintf(stderr, "bench: unknown pivot policy '%s'\n", optarg);
+                exit(2);
+            }
+            pivotPolicy = (PivotPolicy)found;
+            break;
+        case 't':
+            options->thresholdCount = parse_list(optarg, options->thresholds, INT_MAX);
+            break;
+        case 'j':
+            options->threads = (int)parse_number(optarg, 0, INT_MAX);
+            break;
+        case 'n':
+            options->sizeCount = parse_list(optarg, options->sizes, PTRDIFF_MAX / sizeof(int));
+            break;
+        case 'd':
+            found = distribution_parse(optarg);
+            if (found < 0)
+            {
+                fprintf(stderr, "bench: unknown distribution '%s'\n", optarg);
+                exit(2);
+            }
+            options->gen.dist = (Distribution)found;
+            break;
+        case 'r':
+            options->reps = parse_count(optarg);
+            break;
+        case 'w':
+            options->warmup = (int)parse_number(optarg, 0, INT_MAX);
+            break;
+        case 's':
+            options->gen.seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'R':
+            options->gen.range = parse_count(optarg);
+            break;
+        case 'z':
+            options->gen.zipfExponent = atof(optarg);
+            break;
+        case 'u':
+            options->gen.uniqueKeys = parse_count(optarg);
+            break;
+        case 'x':
+            options->gen.swapPercent = atof(optarg);
+            break;
+        case 'l':
+            options->gen.sawtoothRun = parse_count(optarg);
+            break;
+        case 'S':
+            options->schema = optarg;
+            break;
+        case 'o':
+            options->output = optarg;
+            break;
+        case 'K':
+            topK = (ptrdiff_t)parse_number(optarg, 1, PTRDIFF_MAX);
+            break;
+        case 'a':
+            options->autotune = 1;
+            break;
+        case 'h':
+            usage(stdout);
+            exit(0);
+        default:
+            usage(stderr);
+            exit(2);
+        }
+    }
+
+    if (strcmp(options->schema, "bench") != 0 && strcmp(options->schema, "threshold") != 0 &&
+        strcmp(options->schema, "partition") != 0)
+    {
+        fprintf(stderr, "bench: unknown schema '%s'\n", options->schema);
+        exit(2);
+    }
+}
+
+// Open the output; a new or empty file gets the schema's header line first
+static FILE *open_output(const BenchOptions *options)
+{
+    if (options->output == NULL)
+        return stdout;
+    FILE *f = fopen(options->output, "a");
+    if (f == NULL)
+    {
+        perror(options->output);
+        exit(1);
+    }
+    if (ftell(f) == 0)
+    {
+        if (strcmp(options->schema, "threshold") == 0)
+            fprintf(f, "array_size,threshold,time\n");
+        else if (strcmp(options->schema, "partition") == 0)
+            fprintf(f, "partition, array_size, sequential_time, parallel_time\n");
+        else
+            fputs(benchHeader, f);
+    }
+    return f;
+}
+
+static int run_autotune(const BenchOptions *options)
+{
+    char buffer[512];
+    const char *path = options->output != NULL ? options->output : profile_path(buffer, sizeof(buffer));
+    if (path == NULL)
+    {
+        fprintf(stderr, "bench: SORT_PROFILE is empty, give --output\n");
+        return 2;
+    }
+
+    SortProfile profile;
+    if (autotune(&profile, options->sizes, options->sizeCount, stderr) != 0)
+    {
+        fprintf(stderr, "bench: autotune failed, %s left as it was\n", path);
+        return 1;
+    }
+    if (profile_save(path, &profile) != 0)
+    {
+        perror(path);
+        return 1;
+    }
+    printf("%s: pool_threshold %d, small_threshold %d, threads %d\n", path, profile.poolThreshold,
+           profile.smallThreshold, profile.threads);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    parse_options(argc, argv, &options);
+    if (options.autotune)
+        return run_autotune(&options);
+
+    // The topology goes to stderr so the CSV rows stay as they are
+    char topology[1024];
+    numa_describe(topology, sizeof(topology));
+    fprintf(stderr, "bench: %s; numa %s; partition_vector runs on %s\n", topology, numa_mode_name(numaMode),
+            partition_vector_isa());
+
+    SortPool *pool = pool_create(options.threads);
+    if (pool == NULL)
+    {
+        fprintf(stderr, "bench: cannot start the thread pool\n");
+        return 1;
+    }
+    splitStatsEnabled = 1; // One relaxed atomic add per partition of SPLIT_STATS_MIN or more
+    FILE *out = open_output(&options);
+    if (out == stdout && strcmp(options.schema, "bench") == 0)
+        fputs(benchHeader, stdout);
+
+    // Without --threshold the pool keeps its default
+    int thresholdCount = options.thresholdCount > 0 ? options.thresholdCount : 1;
+    for (int s = 0; s < options.sizeCount; s++)
+    {
+        ptrdiff_t size = options.sizes[s];
+        // Under a NUMA mode the pages are placed across the nodes before the first input is generated
+        int *array = numaMode != NUMA_OFF ? (int *)numa_alloc((size_t)size * sizeof(int))
+                                          : (int *)malloc((size_t)size * sizeof(int));
+        if (array == NULL)
+        {
+            fprintf(stderr, "bench: cannot allocate %td elements\n", size);
+            return 1;
+        }
+
+        for (int t = 0; t < thresholdCount; t++)
+        {
+            if (options.thresholdCount > 0)
+                pool_set_threshold(pool, (int)options.thresholds[t]);
+            int threshold = pool_threshold(pool);
+
+            if (strcmp(options.schema, "partition") == 0)
+            {
+                Timing sequential = run(&options, &engines[1], pool, array, size);
+                Timing parallel = run(&options, &engines[0], pool, array, size);
+                fprintf(out, "partition_%s, %td, %f, %f\n", partition_kernel_name(partitionKernel), size,
+                        sequential.median, parallel.median);
+            }
+            else if (strcmp(options.schema, "threshold") == 0)
+            {
+                Timing timing = run(&options, options.engine, pool, array, size);
+                fprintf(out, "2_%d, %d, %f\n", log2_of(size), threshold, timing.median);
+            }
+            else
+            {
+                Timing timing = run(&options, options.engine, pool, array, size);
+                long splits;
+                double balance = split_balance(&splits);
+                fprintf(out, "%s,%s,%s,%s,%d,%d,%td,%d,%s,%d,%d,%f,%f,%f,%.0f,", options.engine->name,
+                        partition_kernel_name(partitionKernel), pivot_policy_name(pivotPolicy),
+                        distribution_name(options.gen.dist), options.gen.range, options.gen.uniqueKeys, size,
+                        pool_size(pool), numa_mode_name(numaMode), threshold, options.reps, timing.min,
+                        timing.median, timing.p95, size / timing.median);
+                if (splits > 0)
+                    fprintf(out, "%f", balance);
+                fprintf(out, "\n");
+            }
+            fflush(out);
+        }
+        if (numaMode != NUMA_OFF)
+            numa_free(array, (size_t)size * sizeof(int));
+        else
+            free(array);
+    }
+
+    if (out != stdout)
+        fclose(out);
+    pool_destroy(pool);
+    return 0;
+}
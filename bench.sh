@@ -0,0 +1,75 @@
+#!/bin/bash
+
+# Build the benchmark driver and run the standard sweeps
+gcc -O2 -o bench -std=c11 -pthread bench.c pool.c numa.c partition.c ppartition.c vpartition.c gen.c profile.c tune.c msort.c ssort.c rsort.c gsort.c argsort.c select.c verify.c -lm
+gcc -O2 -o sortfile -std=c11 -pthread sortfile.c extsort.c ioqueue.c pool.c numa.c partition.c ppartition.c vpartition.c profile.c msort.c ssort.c rsort.c gsort.c textio.c
+gcc -O2 -o compare -std=c11 -pthread compare.c verify.c textio.c pool.c numa.c partition.c ppartition.c vpartition.c profile.c
+
+# Calibrate a new host once; the engines pick up sort_profile.<hostname> at startup:
+#   ./bench --autotune --size 2^20,2^24
+
+SIZES=2^10,2^15,2^20,2^25,2^30
+
+./bench --engine sequential --size $SIZES --output results.csv
+./bench --engine pool --size $SIZES --output results.csv
+./bench --engine merge --size $SIZES --output results.csv
+./bench --engine sample --size $SIZES --output results.csv
+./bench --engine radix --size $SIZES --output results.csv
+./bench --engine radix_msd --size $SIZES --output results.csv
+./bench --engine argsort --size $SIZES --output results.csv
+./bench --engine topk --topk 1000 --size $SIZES --output results.csv
+
+# Past 2^31 elements the indices no longer fit an int: 8 GiB and 16 GiB of keys,
+# plus a buffer of the same size for the out-of-place engines
+LARGE=2^31,2^32
+./bench --engine pool --size $LARGE --reps 3 --warmup 0 --output results.csv
+./bench --engine sample --size $LARGE --reps 3 --warmup 0 --output results.csv
+./bench --engine radix --size $LARGE --reps 3 --warmup 0 --output results.csv
+
+# NUMA hosts: the same 2^30 sort with the array on one node, interleaved, and
+# first-touched by node, told apart by the numa column; the topology is printed
+# on stderr
+for numa in off interleave first_touch; do
+    ./bench --engine pool --size 2^30 --numa $numa --reps 3 --warmup 0 --output results.csv
+done
+
+# Pivot policies on inputs that defeat a first-element pivot; split_balance
+# shows how evenly each policy halves the ranges
+for pivot in first middle median3 ninther sample auto; do
+    for dist in uniform sorted reversed organ_pipe; do
+        ./bench --pivot $pivot --dist $dist --size 2^20,2^25 --output pivot.csv
+    done
+done
+
+# Key cardinality: where the three-way kernel starts to beat Hoare on duplicates
+for kernel in hoare three_way; do
+    for range in 1 4 16 100 1000 10000 100000 1000000; do
+        ./bench --kernel $kernel --dist uniform --range $range --size 2^20 --output cardinality.csv
+    done
+    ./bench --kernel $kernel --dist uniform --size 2^20 --output cardinality.csv
+done
+
+for kernel in hoare lomuto median_of_three three_way block vector; do
+    ./bench --schema partition --kernel $kernel --size 2^10,2^15,2^20,2^25 --output partition.csv
+done
+
+./bench --schema threshold --size 2^20,2^25 --threshold 1000,10000,100000,1000000 --output threshold_v_time.csv
+
+# External sort: 4 GiB of random keys through a 512 MiB budget, MB/s on stderr
+head -c 4G /dev/urandom > keys.bin
+./sortfile --memory 512M keys.bin keys.sorted
+./sortfile --memory 512M --engine radix keys.bin keys.sorted
+./compare --binary keys.bin keys.sorted
+./sortfile --in-place keys.bin
+rm -f keys.bin keys.sorted
+
+# Binary stream: 1 GiB of int64 keys through a pipe, sorted in memory
+head -c 1G /dev/urandom | ./sortfile --type int64 - - > /dev/null
+
+# Text: 2^26 random ints, one per line, parsed, sorted and written back
+python3 -c "import random; print('\\n'.join(str(random.randint(-2**31, 2**31 - 1)) for _ in range(1 << 26)))" > keys.txt
+./sortfile --text keys.txt keys.sorted.txt
+./compare keys.txt keys.sorted.txt
+./sortfile --text --delimiter , keys.txt keys.sorted.csv
+rm -f keys.txt keys.sorted.txt keys.sorted.csv
+
@@ -1,61 +1,203 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
-// Function to compare two integers (used for qsort)
-int compare(const void *a, const void *b) {
-    return (*(int *)a - *(int *)b);
-}
+#include "pool.h"
+#include "textio.h"
+#include "verify.h"
+
+// Check that a sort output is its input, sorted. Files hold decimal ints
+// separated by commas or whitespace, or raw native int keys with --binary:
+//
+//   ./compare                     line 1 of array.txt against line 2
+//   ./compare FILE                the same for FILE
+//   ./compare INPUT OUTPUT        all of INPUT against all of OUTPUT
+//   ./compare --binary keys.bin keys.sorted
+//
+// Nothing is sorted again: the output is checked for order and its multiset
+// hash compared with the input's, both in parallel (verify.h).
+// Exit status: 0 if the output is the sorted input, 1 if not, 2 on errors.
+
+typedef struct
+{
+    int *keys;
+    ptrdiff_t size;
+} Keys;
 
-// Function to parse a line into an array of integers
-int parse_line(char *line, int *array) {
-    int count = 0;
-    char *token = strtok(line, ",");
-    while (token != NULL) {
-        array[count++] = atoi(token);
-        token = strtok(NULL, ",");
+// Read all of path into a malloc()ed buffer with a terminating NUL
+static char *read_file(const char *path, size_t *length)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return NULL;
+    size_t capacity = 1 << 20, bytes = 0;
+    char *buffer = (char *)malloc(capacity);
+    while (buffer != NULL)
+    {
+        if (capacity - bytes < 2)
+        {
+            char *grown = (char *)realloc(buffer, 2 * capacity);
+            if (grown == NULL)
+            {
+                free(buffer);
+                buffer = NULL;
+                errno = ENOMEM;
+                break;
+            }
+            buffer = grown;
+            capacity *= 2;
+        }
+        ssize_t n = read(fd, buffer + bytes, capacity - bytes - 1);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            free(buffer);
+            buffer = NULL;
+            break;
+        }
+        if (n == 0)
+        {
+            buffer[bytes] = '\0';
+            *length = bytes;
+            break;
+        }
+        bytes += (size_t)n;
     }
-    return count;
+    int error = errno;
+    close(fd);
+    errno = error;
+    return buffer;
 }
 
-// Function to check if the second line is a sorted version of the first line
-void check_sorted_version(const char *filename) {
-    FILE *file = fopen(filename, "r");
-    if (file == NULL) {
-        perror("Error opening file");
-        return;
+static int parse_keys(SortPool *pool, const char *name, const char *text, size_t length, Keys *keys)
+{
+    keys->size = parse_ints(pool, text, length, &keys->keys);
+    if (keys->size < 0)
+    {
+        fprintf(stderr, "compare: %s: %s\n", name,
+                errno == EINVAL   ? "not delimited decimal ints"
+                : errno == ERANGE ? "a key is outside int"
+                                  : strerror(errno));
+        return -1;
     }
+    return 0;
+}
 
-    char line1[256], line2[256];
-    if (fgets(line1, sizeof(line1), file) == NULL || fgets(line2, sizeof(line2), file) == NULL) {
-        perror("Error reading lines");
-        fclose(file);
-        return;
+// The keys of a whole file, parsed or taken as they are
+static int load_keys(SortPool *pool, const char *path, int binary, Keys *keys)
+{
+    size_t length;
+    char *buffer = read_file(path, &length);
+    if (buffer == NULL)
+    {
+        fprintf(stderr, "compare: %s: %s\n", path, strerror(errno));
+        return -1;
     }
-    fclose(file);
-
-    int array1[256], array2[256];
-    int n1 = parse_line(line1, array1);
-    int n2 = parse_line(line2, array2);
+    if (!binary)
+    {
+        int status = parse_keys(pool, path, buffer, length, keys);
+        free(buffer);
+        return status;
+    }
+    if (length % sizeof(int) != 0)
+    {
+        fprintf(stderr, "compare: %s is not a whole number of int keys\n", path);
+        free(buffer);
+        return -1;
+    }
+    keys->keys = (int *)buffer; // malloc() alignment suits int
+    keys->size = (ptrdiff_t)(length / sizeof(int));
+    return 0;
+}
 
-    if (n1 != n2) {
-        printf("The second line is not a sorted version of the first line.\n");
-        return;
+// The keys of the first two lines of path
+static int load_lines(SortPool *pool, const char *path, Keys *input, Keys *output)
+{
+    size_t length;
+    char *buffer = read_file(path, &length);
+    if (buffer == NULL)
+    {
+        fprintf(stderr, "compare: %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    char *second = memchr(buffer, '\n', length);
+    if (second == NULL)
+    {
+        fprintf(stderr, "compare: %s has no second line\n", path);
+        free(buffer);
+        return -1;
+    }
+    second++;
+    char *end = memchr(second, '\n', length - (size_t)(second - buffer));
+    if (end == NULL)
+        end = buffer + length;
+    int status = parse_keys(pool, path, buffer, (size_t)(second - buffer), input);
+    if (status == 0 && parse_keys(pool, path, second, (size_t)(end - second), output) < 0)
+    {
+        free(input->keys);
+        status = -1;
     }
+    free(buffer);
+    return status;
+}
 
-    qsort(array1, n1, sizeof(int), compare);
+int main(int argc, char **argv)
+{
+    int binary = argc > 1 && strcmp(argv[1], "--binary") == 0;
+    char **paths = argv + 1 + binary;
+    int pathCount = argc - 1 - binary;
+    if (pathCount > 2 || (binary && pathCount != 2))
+    {
+        fprintf(stderr, "usage: compare [FILE]  |  compare [--binary] INPUT OUTPUT\n");
+        return 2;
+    }
 
-    for (int i = 0; i < n1; i++) {
-        if (array1[i] != array2[i]) {
-            printf("The second line is not a sorted version of the first line.\n");
-            return;
-        }
+    SortPool *pool = pool_create(0);
+    if (pool == NULL)
+    {
+        fprintf(stderr, "compare: cannot start the thread pool\n");
+        return 2;
+    }
+    Keys input, output;
+    int status;
+    if (pathCount == 2)
+    {
+        status = load_keys(pool, paths[0], binary, &input);
+        if (status == 0 && (status = load_keys(pool, paths[1], binary, &output)) < 0)
+            free(input.keys);
+    }
+    else
+    {
+        status = load_lines(pool, pathCount == 1 ? paths[0] : "array.txt", &input, &output);
+    }
+    if (status < 0)
+    {
+        pool_destroy(pool);
+        return 2;
     }
 
-    printf("The second line is a sorted version of the first line.\n");
-}
+    KeyHash hash;
+    key_hash(pool, input.keys, input.size, &hash);
+    ptrdiff_t where;
+    VerifyResult result = verify_sort(pool, &hash, output.keys, output.size, &where);
+    if (result == VERIFY_OK)
+        printf("The output is a sorted version of the input (%td keys).\n", output.size);
+    else if (result == VERIFY_UNSORTED)
+        printf("The output is not sorted: key %td (%d) is greater than key %td (%d).\n", where, output.keys[where],
+               where + 1, output.keys[where + 1]);
+    else if (input.size != output.size)
+        printf("The output has %td keys but the input has %td.\n", output.size, input.size);
+    else
+        printf("The output is sorted but does not hold the same keys as the input.\n");
 
-int main() {
-    check_sorted_version("array.txt");
-    return 0;
-}
\ No newline at end of file
+    free(input.keys);
+    free(output.keys);
+    pool_destroy(pool);
+    return result == VERIFY_OK ? 0 : 1;
+}
@@ -0,0 +1,507 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "extsort.h"
+#include "ioqueue.h"
+
+#define EXTSORT_MIN_RUN (1 << 16) // Fewest keys per run, whatever the budget
+#define MERGE_BLOCK_MIN (1 << 16) // Fewest keys per merge buffer (256 KiB)
+
+// Sorted run of length keys at a byte offset of a temporary file
+typedef struct
+{
+    off_t offset;
+    ptrdiff_t length;
+} Run;
+
+// One input run of a merge, read a block at a time through two buffers
+typedef struct
+{
+    int fd;
+    off_t next;          // File offset of the next block to request
+    ptrdiff_t remaining; // Keys not requested yet
+    int *buffer[2];
+    IoRequest request[2];
+    int active[2];  // request[i] is submitted and not waited on yet
+    int current;    // Buffer being merged
+    int *key;       // Next unmerged key; NULL once the run is used up
+    int *end;
+} RunReader;
+
+// Merge output, written a block at a time through two buffers
+typedef struct
+{
+    int fd;
+    off_t offset; // Offset of the next block, -1 to write at the file position
+    int *buffer[2];
+    IoRequest request[2];
+    int active[2];
+    int current;
+    ptrdiff_t fill;
+    ptrdiff_t capacity;
+} RunWriter;
+
+// Tournament tree over the runs: node[0] is the run with the smallest head
+// key, node[1..count-1] the loser of the match played at that node
+typedef struct
+{
+    int count;
+    int *node;
+    RunReader *runs;
+} LoserTree;
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Create and unlink a temporary file at once, so it vanishes when closed
+static int open_temp(const char *dir)
+{
+    if (dir == NULL)
+    {
+        dir = getenv("TMPDIR");
+        if (dir == NULL || *dir == '\0')
+            dir = "/tmp";
+    }
+    size_t length = strlen(dir) + sizeof("/extsort.XXXXXX");
+    char *path = (char *)malloc(length);
+    if (path == NULL)
+        return -1;
+    snprintf(path, length, "%s/extsort.XXXXXX", dir);
+    int fd = mkstemp(path);
+    if (fd >= 0)
+        unlink(path);
+    free(path);
+    return fd;
+}
+
+// Read until count bytes or end of file; returns the bytes read, or -1
+static ssize_t read_full(int fd, void *buffer, size_t count)
+{
+    size_t done = 0;
+    while (done < count)
+    {
+        ssize_t n = read(fd, (char *)buffer + done, count - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            break;
+        done += (size_t)n;
+    }
+    return (ssize_t)done;
+}
+
+static void reader_request(IoQueue *io, RunReader *reader, int slot, ptrdiff_t blockKeys)
+{
+    if (reader->remaining == 0)
+        return;
+    ptrdiff_t keys = reader->remaining < blockKeys ? reader->remaining : blockKeys;
+    reader->request[slot] = (IoRequest){.fd = reader->fd,
+                                         .buffer = reader->buffer[slot],
+                                         .bytes = (size_t)keys * sizeof(int),
+                                         .offset = reader->next,
+                                         .write = 0};
+    io_submit(io, &reader->request[slot]);
+    reader->active[slot] = 1;
+    reader->next += (off_t)keys * (off_t)sizeof(int);
+    reader->remaining -= keys;
+}
+
+// Move on to the other buffer once the current one is merged, and reuse the
+// current one for the block after that
+static int reader_advance(IoQueue *io, RunReader *reader, ptrdiff_t blockKeys)
+{
+    int used = reader->current;
+    int other = used ^ 1;
+    if (!reader->active[other])
+    {
+        reader->key = NULL;
+        reader->end = NULL;
+        return 0;
+    }
+    reader->active[other] = 0;
+    ssize_t got = io_wait(io, &reader->request[other]);
+    if (got <= 0 || got % sizeof(int) != 0)
+    {
+        if (got >= 0)
+            errno = EIO; // A run file ended early
+        return -1;
+    }
+    reader->current = other;
+    reader->key = reader->buffer[other];
+    reader->end = reader->key + got / sizeof(int);
+    reader_request(io, reader, used, blockKeys);
+    return 0;
+}
+
+// Wait out the reads still in flight before their buffers are freed
+static void reader_drain(IoQueue *io, RunReader *reader)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (reader->active[i])
+            io_wait(io, &reader->request[i]);
+        reader->active[i] = 0;
+    }
+}
+
+// Hand the full buffer to the I/O thread and continue in the other one
+static int writer_flush(IoQueue *io, RunWriter *writer)
+{
+    if (writer->fill == 0)
+        return 0;
+    int full = writer->current;
+    size_t bytes = (size_t)writer->fill * sizeof(int);
+    writer->request[full] = (IoRequest){.fd = writer->fd,
+                                         .buffer = writer->buffer[full],
+                                         .bytes = bytes,
+                                         .offset = writer->offset,
+                                         .write = 1};
+    io_submit(io, &writer->request[full]);
+    writer->active[full] = 1;
+    if (writer->offset >= 0)
+        writer->offset += (off_t)bytes;
+    writer->fill = 0;
+    writer->current = full ^ 1;
+    if (writer->active[writer->current])
+    {
+        writer->active[writer->current] = 0;
+        if (io_wait(io, &writer->request[writer->current]) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+static int writer_finish(IoQueue *io, RunWriter *writer)
+{
+    int status = writer_flush(io, writer);
+    for (int i = 0; i < 2; i++)
+    {
+        if (writer->active[i] && io_wait(io, &writer->request[i]) < 0)
+            status = -1;
+        writer->active[i] = 0;
+    }
+    return status;
+}
+
+// Run a wins against run b: it has keys left and the smaller head key; ties go
+// to the lower run
+static inline int beats(const RunReader *runs, int a, int b)
+{
+    if (runs[a].key == NULL)
+        return 0;
+    if (runs[b].key == NULL)
+        return 1;
+    return *runs[a].key < *runs[b].key || (*runs[a].key == *runs[b].key && a < b);
+}
+
+// Play the matches below node and return the winner. Runs are the leaves
+// count..2*count-1 of an implicit binary tree, so any count works.
+static int tree_build(LoserTree *tree, int node)
+{
+    if (node >= tree->count)
+        return node - tree->count;
+    int a = tree_build(tree, 2 * node);
+    int b = tree_build(tree, 2 * node + 1);
+    if (beats(tree->runs, a, b))
+    {
+        tree->node[node] = b;
+        return a;
+    }
+    tree->node[node] = a;
+    return b;
+}
+
+// The winner's head key changed: replay its matches up to the root, one per level
+static void tree_replay(LoserTree *tree, int winner)
+{
+    for (int node = (winner + tree->count) / 2; node > 0; node /= 2)
+    {
+        if (beats(tree->runs, tree->node[node], winner))
+        {
+            int loser = winner;
+            winner = tree->node[node];
+            tree->node[node] = loser;
+        }
+    }
+    tree->node[0] = winner;
+}
+
+// Merge runs[0..count-1] of inFd into the writer. memory holds two blocks per run.
+static int merge_group(IoQueue *io, int inFd, const Run *runs, int count, RunReader *readers, int *nodes,
+                       int *memory, ptrdiff_t blockKeys, RunWriter *writer)
+{
+    int status = 0;
+    for (int i = 0; i < count; i++)
+    {
+        RunReader *reader = &readers[i];
+        memset(reader, 0, sizeof(*reader));
+        reader->fd = inFd;
+        reader->next = runs[i].offset;
+        reader->remaining = runs[i].length;
+        reader->buffer[0] = memory + 2 * i * blockKeys;
+        reader->buffer[1] = reader->buffer[0] + blockKeys;
+        reader->current = 1;
+        reader_request(io, reader, 0, blockKeys);
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (reader_advance(io, &readers[i], blockKeys) < 0)
+            status = -1;
+    }
+
+    LoserTree tree = {count, nodes, readers};
+    tree.node[0] = tree_build(&tree, 1);
+    while (status == 0)
+    {
+        int winner = tree.node[0];
+        RunReader *reader = &readers[winner];
+        if (reader->key == NULL)
+            break; // Every run is used up
+        writer->buffer[writer->current][writer->fill++] = *reader->key++;
+        if (writer->fill == writer->capacity && writer_flush(io, writer) < 0)
+            status = -1;
+        if (reader->key == reader->end && reader_advance(io, reader, blockKeys) < 0)
+            status = -1;
+        tree_replay(&tree, winner);
+    }
+
+    for (int i = 0; i < count; i++)
+        reader_drain(io, &readers[i]);
+    return status;
+}
+
+// Phase 1: read, sort and spill runs of runKeys keys, writing one run while the
+// next is read and sorted. Input that fits in a single short run goes straight
+// to outputFd. Returns the number of runs spilled, or -1.
+static int form_runs(SortPool *pool, IoQueue *io, int inputFd, int outputFd, int tempFd, ptrdiff_t runKeys,
+                     void (*sortRun)(SortPool *, int *, ptrdiff_t), Run **runs, long long *bytes)
+{
+    int *buffer[2];
+    buffer[0] = (int *)malloc((size_t)runKeys * sizeof(int));
+    buffer[1] = (int *)malloc((size_t)runKeys * sizeof(int));
+    IoRequest spill[2];
+    int pending[2] = {0, 0};
+    Run *list = NULL;
+    int count = 0, capacity = 0;
+    off_t offset = 0;
+    int status = buffer[0] != NULL && buffer[1] != NULL ? 0 : -1;
+
+    for (int b = 0; status == 0; b ^= 1)
+    {
+        if (pending[b])
+        {
+            pending[b] = 0;
+            if (io_wait(io, &spill[b]) < 0)
+            {
+                status = -1;
+                break;
+            }
+        }
+        ssize_t got = read_full(inputFd, buffer[b], (size_t)runKeys * sizeof(int));
+        if (got < 0 || got % sizeof(int) != 0)
+        {
+            if (got >= 0)
+                errno = EINVAL; // Trailing partial key
+            status = -1;
+            break;
+        }
+        if (got == 0)
+            break;
+        ptrdiff_t keys = got / sizeof(int);
+        *bytes += got;
+        sortRun(pool, buffer[b], keys);
+
+        if (count == 0 && keys < runKeys)
+        {
+            // The whole input fit in one run: no spill and no merge
+            IoRequest out = {.fd = outputFd, .buffer = buffer[b], .bytes = (size_t)got, .offset = -1, .write = 1};
+            io_submit(io, &out);
+            if (io_wait(io, &out) < 0)
+                status = -1;
+            break;
+        }
+
+        if (count == capacity)
+        {
+            capacity = capacity > 0 ? 2 * capacity : 64;
+            Run *grown = (Run *)realloc(list, capacity * sizeof(Run));
+            if (grown == NULL)
+            {
+                status = -1;
+                break;
+            }
+            list = grown;
+        }
+        list[count++] = (Run){offset, keys};
+        spill[b] = (IoRequest){.fd = tempFd, .buffer = buffer[b], .bytes = (size_t)got, .offset = offset, .write = 1};
+        io_submit(io, &spill[b]);
+        pending[b] = 1;
+        offset += got;
+    }
+
+    for (int b = 0; b < 2; b++)
+    {
+        if (pending[b] && io_wait(io, &spill[b]) < 0)
+            status = -1;
+    }
+    free(buffer[0]);
+    free(buffer[1]);
+    *runs = list;
+    return status < 0 ? -1 : count;
+}
+
+// Phase 2: merge passes of fanIn runs at a time until one pass takes every run,
+// which then writes to outputFd. Each run gets two blocks of the budget, the
+// output another two.
+static int merge_runs(IoQueue *io, int tempFd, const Run *runs, int count, int outputFd,
+                      const ExtSortOptions *options, ExtSortStats *stats)
+{
+    ptrdiff_t budgetKeys = (ptrdiff_t)(options->memoryBytes / sizeof(int));
+    ptrdiff_t fanIn = budgetKeys / MERGE_BLOCK_MIN / 2 - 1;
+    if (fanIn < 2)
+        fanIn = 2;
+
+    int inFd = tempFd;
+    Run *owned = NULL; // Runs of an intermediate pass
+    int status = 0;
+    while (status == 0)
+    {
+        int final = count <= fanIn;
+        int groupSize = final ? count : (int)fanIn;
+        int groups = (count + groupSize - 1) / groupSize;
+        ptrdiff_t blockKeys = budgetKeys / (2 * groupSize + 2);
+        if (blockKeys < MERGE_BLOCK_MIN)
+            blockKeys = MERGE_BLOCK_MIN;
+
+        int *memory = (int *)malloc((size_t)(2 * groupSize + 2) * blockKeys * sizeof(int));
+        RunReader *readers = (RunReader *)malloc(groupSize * sizeof(RunReader));
+        int *nodes = (int *)malloc(groupSize * sizeof(int));
+        Run *merged = final ? NULL : (Run *)malloc(groups * sizeof(Run));
+        int outFd = final ? outputFd : open_temp(options->tempDir);
+        if (memory == NULL || readers == NULL || nodes == NULL || (!final && merged == NULL) || outFd < 0)
+            status = -1;
+
+        RunWriter writer;
+        memset(&writer, 0, sizeof(writer));
+        writer.fd = outFd;
+        writer.offset = final ? -1 : 0;
+        writer.capacity = blockKeys;
+        if (memory != NULL)
+        {
+            writer.buffer[0] = memory + 2 * groupSize * blockKeys;
+            writer.buffer[1] = writer.buffer[0] + blockKeys;
+        }
+
+        off_t offset = 0;
+        for (int g = 0; g < groups && status == 0; g++)
+        {
+            int first = g * groupSize;
+            int n = count - first < groupSize ? count - first : groupSize;
+            if (!final)
+            {
+                // Groups are written back to back, so each merged run starts where the last ended
+                ptrdiff_t length = 0;
+                for (int i = first; i < first + n; i++)
+                    length += runs[i].length;
+                merged[g] = (Run){offset, length};
+                offset += (off_t)length * (off_t)sizeof(int);
+            }
+            status = merge_group(io, inFd, runs + first, n, readers, nodes, memory, blockKeys, &writer);
+        }
+        if (writer_finish(io, &writer) < 0)
+            status = -1;
+        stats->mergePasses++;
+
+        free(memory);
+        free(readers);
+        free(nodes);
+        if (inFd != tempFd)
+            close(inFd);
+        free(owned);
+        owned = merged;
+        runs = merged;
+        count = groups;
+        inFd = outFd;
+        if (final)
+            break;
+    }
+
+    // An intermediate pass that failed leaves its file open
+    if (inFd != tempFd && inFd != outputFd && inFd >= 0)
+        close(inFd);
+    free(owned);
+    return status;
+}
+
+void extsort_default_options(ExtSortOptions *options)
+{
+    options->memoryBytes = (size_t)1 << 30;
+    options->tempDir = NULL;
+    options->sortRun = pool_sort;
+    options->scratchPerKey = 0;
+}
+
+int external_sort(SortPool *pool, int inputFd, int outputFd, const ExtSortOptions *options, ExtSortStats *stats)
+{
+    ExtSortOptions defaults;
+    if (options == NULL)
+    {
+        extsort_default_options(&defaults);
+        options = &defaults;
+    }
+    ExtSortStats unused;
+    if (stats == NULL)
+        stats = &unused;
+    memset(stats, 0, sizeof(*stats));
+
+    IoQueue *io = io_queue_create();
+    if (io == NULL)
+        return -1;
+    int tempFd = open_temp(options->tempDir);
+    if (tempFd < 0)
+    {
+        int error = errno;
+        io_queue_destroy(io);
+        errno = error;
+        return -1;
+    }
+
+    // Two run buffers, so one can be spilled while the other is filled, plus
+    // the engine's scratch for the one being sorted
+    ptrdiff_t runKeys = (ptrdiff_t)(options->memoryBytes / (2 * sizeof(int) + options->scratchPerKey));
+    if (runKeys < EXTSORT_MIN_RUN)
+        runKeys = EXTSORT_MIN_RUN;
+
+    double start = now();
+    Run *runs = NULL;
+    int count = form_runs(pool, io, inputFd, outputFd, tempFd, runKeys,
+                          options->sortRun != NULL ? options->sortRun : pool_sort, &runs, &stats->bytes);
+    stats->runSeconds = now() - start;
+    int status = count < 0 ? -1 : 0;
+    if (count > 0)
+    {
+        stats->runs = count;
+        start = now();
+        status = merge_runs(io, tempFd, runs, count, outputFd, options, stats);
+        stats->mergeSeconds = now() - start;
+    }
+
+    int error = errno;
+    free(runs);
+    close(tempFd);
+    io_queue_destroy(io);
+    errno = error;
+    return status;
+}
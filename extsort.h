@@ -0,0 +1,42 @@
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+#include <stddef.h>
+
+#include "pool.h"
+
+// External sort of raw native-endian int keys that need not fit in memory.
+// Runs are read, sorted on the pool and spilled to an unlinked temporary file
+// while the next run is read and sorted. Two run buffers and the scratch the
+// run engine allocates fit the memory budget together. The runs
+// are then merged through a loser tree. Every run is read through two buffers,
+// so its next block is in flight while the current one is merged, and the
+// output is written the same way. When the budget cannot give every run its
+// two buffers, groups of runs are first merged into longer runs.
+
+typedef struct
+{
+    size_t memoryBytes;  // Budget for keys held in memory
+    const char *tempDir; // Where runs are spilled; NULL = $TMPDIR, else /tmp
+    void (*sortRun)(SortPool *pool, int *array, ptrdiff_t size); // Engine for the runs
+    size_t scratchPerKey; // Bytes sortRun allocates per key it sorts, 0 for in-place engines
+} ExtSortOptions;
+
+typedef struct
+{
+    long long bytes;     // Input size
+    int runs;            // Sorted runs spilled, 0 if the input fit in one
+    int mergePasses;     // Passes over the data after the runs are formed
+    double runSeconds;   // Reading, sorting and spilling the runs
+    double mergeSeconds; // Merging them into the output
+} ExtSortStats;
+
+// Defaults: 1 GiB budget, $TMPDIR or /tmp, pool_sort() for the runs (no scratch)
+void extsort_default_options(ExtSortOptions *options);
+
+// Sort the keys read from inputFd up to end of file into outputFd. Both may be
+// pipes. Returns 0, or -1 with errno set if I/O or an allocation fails, or
+// EINVAL if the input is not a whole number of keys. stats may be NULL.
+int external_sort(SortPool *pool, int inputFd, int outputFd, const ExtSortOptions *options, ExtSortStats *stats);
+
+#endif
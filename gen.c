@@ -0,0 +1,289 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "gen.h"
+
+#define GEN_MAX_THREADS 256
+
+static const char *distNames[DIST_COUNT] = {
+    "uniform", "sorted", "reversed", "sawtooth", "organ_pipe", "zipf", "few_unique", "nearly_sorted", "all_equal"};
+
+// PCG32 (O'Neill, pcg32_random_r): 64-bit LCG state, xorshift-rotate output
+typedef struct
+{
+    uint64_t state;
+    uint64_t inc;
+} Pcg32;
+
+static uint32_t pcg32_next(Pcg32 *rng)
+{
+    uint64_t old = rng->state;
+    rng->state = old * 6364136223846793005ULL + rng->inc;
+    uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t)(old >> 59);
+    return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+}
+
+// Independent stream per chunk: same seed, stream selected by the chunk index
+static void pcg32_seed(Pcg32 *rng, uint64_t seed, uint64_t stream)
+{
+    rng->state = 0;
+    rng->inc = (stream << 1) | 1;
+    pcg32_next(rng);
+    rng->state += seed;
+    pcg32_next(rng);
+}
+
+// Uniform in [0, bound) by multiply-shift (Lemire); the bias is below 2^-32 * bound
+static uint32_t pcg32_bounded(Pcg32 *rng, uint32_t bound)
+{
+    return (uint32_t)(((uint64_t)pcg32_next(rng) * bound) >> 32);
+}
+
+// Uniform in [0, 1)
+static double pcg32_double(Pcg32 *rng)
+{
+    return pcg32_next(rng) * (1.0 / 4294967296.0);
+}
+
+// Zipf sampling by rejection-inversion (Hörmann and Derflinger, 1996): O(1) per
+// sample and no table, so every chunk can sample on its own.
+typedef struct
+{
+    double exponent;
+    double n;
+    double hIntegralX1;
+    double hIntegralN;
+    double s;
+} ZipfSampler;
+
+// log1p(x) / x and expm1(x) / x, both continuous at 0
+static double helper1(double x)
+{
+    return fabs(x) > 1e-8 ? log1p(x) / x : 1 - x / 2 + x * x / 3;
+}
+
+static double helper2(double x)
+{
+    return fabs(x) > 1e-8 ? expm1(x) / x : 1 + x / 2 + x * x / 6;
+}
+
+static double zipf_h(const ZipfSampler *z, double x)
+{
+    return exp(-z->exponent * log(x));
+}
+
+static double zipf_h_integral(const ZipfSampler *z, double x)
+{
+    double logX = log(x);
+    return helper2((1 - z->exponent) * logX) * logX;
+}
+
+static double zipf_h_integral_inverse(const ZipfSampler *z, double x)
+{
+    double t = x * (1 - z->exponent);
+    if (t < -1)
+        t = -1; // Limit rounding errors
+    return exp(helper1(t) * x);
+}
+
+static void zipf_init(ZipfSampler *z, int n, double exponent)
+{
+    z->exponent = exponent;
+    z->n = n;
+    z->hIntegralX1 = zipf_h_integral(z, 1.5) - 1;
+    z->hIntegralN = zipf_h_integral(z, n + 0.5);
+    z->s = 2 - zipf_h_integral_inverse(z, zipf_h_integral(z, 2.5) - zipf_h(z, 2));
+}
+
+// Rank in [1, n]
+static int zipf_sample(const ZipfSampler *z, Pcg32 *rng)
+{
+    while (1)
+    {
+        double u = z->hIntegralN + pcg32_double(rng) * (z->hIntegralX1 - z->hIntegralN);
+        double x = zipf_h_integral_inverse(z, u);
+        double k = floor(x + 0.5);
+        if (k < 1)
+            k = 1;
+        else if (k > z->n)
+            k = z->n;
+        if (k - x <= z->s || u >= zipf_h_integral(z, k + 0.5) - zipf_h(z, k))
+            return (int)k;
+    }
+}
+
+typedef struct
+{
+    int *array;
+    ptrdiff_t size;
+    const GenOptions *options;
+    ZipfSampler zipf;
+    int keyShift; // Index-derived keys are index >> keyShift so they fit an int
+    atomic_long nextChunk;
+} GenShared;
+
+static void fill_chunk(GenShared *shared, ptrdiff_t chunk)
+{
+    const GenOptions *options = shared->options;
+    int *array = shared->array;
+    ptrdiff_t size = shared->size;
+    int shift = shared->keyShift;
+    ptrdiff_t start = chunk * GEN_CHUNK;
+    ptrdiff_t end = size - start > GEN_CHUNK ? start + GEN_CHUNK : size;
+    Pcg32 rng;
+    pcg32_seed(&rng, options->seed, (uint64_t)chunk);
+
+    switch (options->dist)
+    {
+    case DIST_UNIFORM:
+        for (ptrdiff_t i = start; i < end; i++)
+        {
+            if (options->range > 0)
+                array[i] = (int)pcg32_bounded(&rng, (uint32_t)options->range);
+            else
+                array[i] = (int)(pcg32_next(&rng) >> 1);
+        }
+        break;
+    case DIST_SORTED:
+        for (ptrdiff_t i = start; i < end; i++)
+            array[i] = (int)(i >> shift);
+        break;
+    case DIST_REVERSED:
+        for (ptrdiff_t i = start; i < end; i++)
+            array[i] = (int)((size - i) >> shift);
+        break;
+    case DIST_SAWTOOTH:
+        for (ptrdiff_t i = start; i < end; i++)
+            array[i] = (int)(i % options->sawtoothRun);
+        break;
+    case DIST_ORGAN_PIPE:
+        for (ptrdiff_t i = start; i < end; i++)
+            array[i] = (int)((i < size / 2 ? i : size - i) >> shift);
+        break;
+    case DIST_ZIPF:
+        for (ptrdiff_t i = start; i < end; i++)
+            array[i] = zipf_sample(&shared->zipf, &rng);
+        break;
+    case DIST_FEW_UNIQUE:
+    {
+        // Spread the keys over the int range so they are not also tiny numbers
+        int step = INT32_MAX / options->uniqueKeys;
+        for (ptrdiff_t i = start; i < end; i++)
+            array[i] = (int)pcg32_bounded(&rng, (uint32_t)options->uniqueKeys) * step;
+        break;
+    }
+    case DIST_NEARLY_SORTED:
+    {
+        for (ptrdiff_t i = start; i < end; i++)
+            array[i] = (int)(i >> shift);
+        // Swaps stay inside the chunk so chunks never touch each other
+        int length = (int)(end - start);
+        long swaps = (long)(length * options->swapPercent / 200);
+        for (long s = 0; s < swaps; s++)
+        {
+            ptrdiff_t a = start + pcg32_bounded(&rng, (uint32_t)length);
+            ptrdiff_t b = start + pcg32_bounded(&rng, (uint32_t)length);
+            int temp = array[a];
+            array[a] = array[b];
+            array[b] = temp;
+        }
+        break;
+    }
+    default:
+        for (ptrdiff_t i = start; i < end; i++)
+            array[i] = 42;
+        break;
+    }
+}
+
+static void *gen_worker(void *arg)
+{
+    GenShared *shared = (GenShared *)arg;
+    ptrdiff_t chunks = (shared->size + GEN_CHUNK - 1) / GEN_CHUNK;
+    while (1)
+    {
+        ptrdiff_t chunk = atomic_fetch_add(&shared->nextChunk, 1);
+        if (chunk >= chunks)
+            break;
+        fill_chunk(shared, chunk);
+    }
+    return NULL;
+}
+
+void gen_default_options(GenOptions *options)
+{
+    options->dist = DIST_UNIFORM;
+    options->seed = 1;
+    options->threads = 0;
+    options->range = 0;
+    options->uniqueKeys = 16;
+    options->sawtoothRun = 1 << 12;
+    options->zipfExponent = 1.0;
+    options->swapPercent = 1.0;
+}
+
+const char *distribution_name(Distribution dist)
+{
+    return distNames[dist];
+}
+
+int distribution_parse(const char *name)
+{
+    for (int i = 0; i < DIST_COUNT; i++)
+    {
+        if (strcmp(name, distNames[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+void generate_input(int *array, ptrdiff_t size, const GenOptions *options)
+{
+    GenOptions fixed = *options;
+    if (fixed.uniqueKeys < 1)
+        fixed.uniqueKeys = 1;
+    if (fixed.sawtoothRun < 1)
+        fixed.sawtoothRun = 1;
+
+    GenShared shared;
+    shared.array = array;
+    shared.size = size;
+    shared.options = &fixed;
+    atomic_init(&shared.nextChunk, 0);
+    shared.keyShift = 0;
+    while ((size >> shared.keyShift) > INT_MAX)
+        shared.keyShift++;
+    if (fixed.dist == DIST_ZIPF)
+    {
+        ptrdiff_t n = fixed.range > 0 ? fixed.range : (size > INT_MAX ? INT_MAX : (size > 0 ? size : 1));
+        zipf_init(&shared.zipf, (int)n, fixed.zipfExponent);
+    }
+
+    ptrdiff_t chunks = (size + GEN_CHUNK - 1) / GEN_CHUNK;
+    int threads = fixed.threads > 0 ? fixed.threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads > chunks)
+        threads = (int)chunks;
+    if (threads > GEN_MAX_THREADS)
+        threads = GEN_MAX_THREADS;
+
+    // The calling thread takes chunks too
+    pthread_t workers[GEN_MAX_THREADS];
+    int started = 0;
+    for (int t = 1; t < threads; t++)
+    {
+        if (pthread_create(&workers[started], NULL, gen_worker, &shared) == 0)
+            started++;
+    }
+    gen_worker(&shared);
+    for (int t = 0; t < started; t++)
+        pthread_join(workers[t], NULL);
+}
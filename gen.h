@@ -0,0 +1,51 @@
+#ifndef GEN_H
+#define GEN_H
+
+#include <stddef.h>
+
+// Seedable input generator for benchmarks. The array is filled in chunks of
+// GEN_CHUNK elements by several threads; each chunk has its own PCG32 stream,
+// so the output depends only on the seed, never on the thread count.
+// Self-contained (pthreads only) so the standalone programs can link it.
+
+#define GEN_CHUNK (1 << 16)
+
+typedef enum
+{
+    DIST_UNIFORM,       // Uniform keys in [0, range), or all non-negative ints if range is 0
+    DIST_SORTED,        // 0, 1, 2, ... (past INT_MAX elements, index >> k for the smallest k that fits)
+    DIST_REVERSED,      // size, size - 1, ..., 1
+    DIST_SAWTOOTH,      // Ascending runs of sawtoothRun keys
+    DIST_ORGAN_PIPE,    // Ascending first half, descending second half
+    DIST_ZIPF,          // Zipf ranks over [1, range] (range 0: [1, size]), exponent zipfExponent
+    DIST_FEW_UNIQUE,    // uniqueKeys distinct keys, uniformly mixed
+    DIST_NEARLY_SORTED, // Sorted, then swapPercent% of the elements swapped locally
+    DIST_ALL_EQUAL,     // One key repeated
+    DIST_COUNT
+} Distribution;
+
+typedef struct
+{
+    Distribution dist;
+    unsigned long long seed;
+    int threads;         // 0 = one per online core
+    int range;           // Key range for uniform and zipf
+    int uniqueKeys;      // Distinct keys for few-unique
+    int sawtoothRun;     // Run length for sawtooth
+    double zipfExponent; // s > 0; 1 is the classic Zipf law
+    double swapPercent;  // Share of elements moved by nearly-sorted
+} GenOptions;
+
+// Defaults: uniform over all non-negative ints, seed 1, all cores
+void gen_default_options(GenOptions *options);
+
+// Name used on command lines and in CSV output
+const char *distribution_name(Distribution dist);
+
+// Parse a distribution name; returns -1 if unknown
+int distribution_parse(const char *name);
+
+// Fill array[0..size-1]
+void generate_input(int *array, ptrdiff_t size, const GenOptions *options);
+
+#endif
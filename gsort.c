@@ -0,0 +1,42 @@
+#include "gsort.h"
+
+// a < b, with NaNs after everything else
+#define FLOAT_LESS(a, b) ((a) < (b) || ((b) != (b) && (a) == (a)))
+
+// int32 is instantiated by ssort.c, on the int leaf kernels
+
+#define GSORT_SUFFIX uint32
+#define GSORT_TYPE uint32_t
+#define GSORT_LESS(a, b) ((a) < (b))
+#include "gsort_impl.h"
+
+#define GSORT_SUFFIX int64
+#define GSORT_TYPE int64_t
+#define GSORT_LESS(a, b) ((a) < (b))
+#include "gsort_impl.h"
+
+#define GSORT_SUFFIX uint64
+#define GSORT_TYPE uint64_t
+#define GSORT_LESS(a, b) ((a) < (b))
+#include "gsort_impl.h"
+
+#define GSORT_SUFFIX float
+#define GSORT_TYPE float
+#define GSORT_LESS(a, b) FLOAT_LESS(a, b)
+#include "gsort_impl.h"
+
+#define GSORT_SUFFIX double
+#define GSORT_TYPE double
+#define GSORT_LESS(a, b) FLOAT_LESS(a, b)
+#include "gsort_impl.h"
+
+#define GSORT_SUFFIX key_payload
+#define GSORT_TYPE KeyPayload
+#define GSORT_LESS(a, b) ((a).key < (b).key)
+#include "gsort_impl.h"
+
+// Ties broken by payload, so (key, row id) pairs come out in a stable order
+#define GSORT_SUFFIX key_payload_stable
+#define GSORT_TYPE KeyPayload
+#define GSORT_LESS(a, b) ((a).key < (b).key || ((a).key == (b).key && (a).payload < (b).payload))
+#include "gsort_impl.h"
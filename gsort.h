@@ -0,0 +1,36 @@
+#ifndef GSORT_H
+#define GSORT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pool.h"
+
+// Type-generic sorts, one per element type, generated from gsort_impl.h with the
+// comparison inlined. Arrays of at least GSORT_PARALLEL_MIN elements are sample
+// sorted on the pool; smaller ones, or pool == NULL, run introsort in the caller.
+// gsort_int32() is instantiated in ssort.c on the int leaf kernels of
+// partition.h and is what pool_sample_sort() runs; link ssort.c to use it.
+
+// 16-byte record ordered by key; the payload (e.g. a row id) travels along
+typedef struct
+{
+    int64_t key;
+    int64_t payload;
+} KeyPayload;
+
+void gsort_int32(SortPool *pool, int32_t *array, ptrdiff_t size);
+void gsort_uint32(SortPool *pool, uint32_t *array, ptrdiff_t size);
+void gsort_int64(SortPool *pool, int64_t *array, ptrdiff_t size);
+void gsort_uint64(SortPool *pool, uint64_t *array, ptrdiff_t size);
+
+// Floating point: NaNs sort after every number, -0.0 and 0.0 compare equal
+void gsort_float(SortPool *pool, float *array, ptrdiff_t size);
+void gsort_double(SortPool *pool, double *array, ptrdiff_t size);
+
+void gsort_key_payload(SortPool *pool, KeyPayload *array, ptrdiff_t size);
+
+// Same records, equal keys ordered by payload
+void gsort_key_payload_stable(SortPool *pool, KeyPayload *array, ptrdiff_t size);
+
+#endif
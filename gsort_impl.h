@@ -0,0 +1,323 @@
+// Type-generic sort, instantiated once per element type. Before including, define
+//   GSORT_SUFFIX       name suffix: gsort_<suffix>() is generated
+//   GSORT_TYPE         element type
+//   GSORT_LESS(a, b)   strict weak order on two GSORT_TYPE values
+// and optionally
+//   GSORT_LEAF         void f(GSORT_TYPE *array, ptrdiff_t size) that sorts the
+//                      buckets and small arrays in place of the generic introsort
+// Every comparison is the macro expanded in place, so nothing goes through a
+// function pointer the way qsort() does. No include guard: included once per type.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pool.h"
+
+#ifndef GSORT_SMALL
+#define GSORT_SMALL 24                // Ranges this small are finished by insertion sort
+#define GSORT_PARALLEL_MIN (1 << 16)  // Smaller arrays are sorted by the caller alone
+#define GSORT_BUCKETS_PER_WORKER 8    // Buckets per worker, so stealing can even out the sizes
+#define GSORT_OVERSAMPLING 32         // Sample keys per bucket
+#endif
+
+#define GSORT_CAT_(a, b) a##b
+#define GSORT_CAT(a, b) GSORT_CAT_(a, b)
+#define GSORT_FN(name) GSORT_CAT(GSORT_CAT(gsort_, GSORT_SUFFIX), GSORT_CAT(_, name))
+
+typedef struct
+{
+    GSORT_TYPE *array;
+    GSORT_TYPE *buffer;
+    uint16_t *bucketOf;
+    ptrdiff_t size;
+    int parts;
+    GSORT_TYPE *splitters; // Sorted, distinct
+    int splitterCount;
+    int buckets;           // 2 * splitterCount + 1, odd ones hold keys equal to a splitter
+    ptrdiff_t *counts;     // parts x buckets: histogram, then write offsets
+    ptrdiff_t *bucketStart;
+} GSORT_FN(Shared);
+
+#ifdef GSORT_LEAF
+
+static void GSORT_FN(sequential)(GSORT_TYPE *array, ptrdiff_t size)
+{
+    GSORT_LEAF(array, size);
+}
+
+#else
+
+static void GSORT_FN(insertion_sort)(GSORT_TYPE *array, ptrdiff_t left, ptrdiff_t right)
+{
+    for (ptrdiff_t i = left + 1; i <= right; i++)
+    {
+        GSORT_TYPE key = array[i];
+        ptrdiff_t j = i - 1;
+        while (j >= left && GSORT_LESS(key, array[j]))
+        {
+            array[j + 1] = array[j];
+            j--;
+        }
+        array[j + 1] = key;
+    }
+}
+
+static void GSORT_FN(swap)(GSORT_TYPE *a, GSORT_TYPE *b)
+{
+    GSORT_TYPE temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+static void GSORT_FN(sift_down)(GSORT_TYPE *base, ptrdiff_t root, ptrdiff_t size)
+{
+    GSORT_TYPE value = base[root];
+    while (1)
+    {
+        ptrdiff_t child = 2 * root + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && GSORT_LESS(base[child], base[child + 1]))
+            child++;
+        if (!GSORT_LESS(value, base[child]))
+            break;
+        base[root] = base[child];
+        root = child;
+    }
+    base[root] = value;
+}
+
+static void GSORT_FN(heapsort)(GSORT_TYPE *array, ptrdiff_t left, ptrdiff_t right)
+{
+    GSORT_TYPE *base = array + left;
+    ptrdiff_t size = right - left + 1;
+    for (ptrdiff_t root = size / 2 - 1; root >= 0; root--)
+        GSORT_FN(sift_down)(base, root, size);
+    for (ptrdiff_t end = size - 1; end > 0; end--)
+    {
+        GSORT_FN(swap)(&base[0], &base[end]);
+        GSORT_FN(sift_down)(base, 0, end);
+    }
+}
+
+// Hoare partition around the median of first, middle and last, which are
+// sorted in place first. Returns the last index of the left half.
+static ptrdiff_t GSORT_FN(partition)(GSORT_TYPE *array, ptrdiff_t low, ptrdiff_t high)
+{
+    ptrdiff_t mid = low + (high - low) / 2;
+    if (GSORT_LESS(array[mid], array[low]))
+        GSORT_FN(swap)(&array[mid], &array[low]);
+    if (GSORT_LESS(array[high], array[low]))
+        GSORT_FN(swap)(&array[high], &array[low]);
+    if (GSORT_LESS(array[high], array[mid]))
+        GSORT_FN(swap)(&array[high], &array[mid]);
+    GSORT_TYPE pivot = array[mid];
+
+    ptrdiff_t i = low - 1, j = high + 1;
+    while (1)
+    {
+        do
+            i++;
+        while (GSORT_LESS(array[i], pivot));
+        do
+            j--;
+        while (GSORT_LESS(pivot, array[j]));
+        if (i >= j)
+            return j;
+        GSORT_FN(swap)(&array[i], &array[j]);
+    }
+}
+
+// Introsort like introsort() in partition.c: heapsort past depthLimit levels,
+// insertion sort for ranges of at most GSORT_SMALL elements
+static void GSORT_FN(introsort)(GSORT_TYPE *array, ptrdiff_t left, ptrdiff_t right, int depthLimit)
+{
+    while (right - left + 1 > GSORT_SMALL)
+    {
+        if (depthLimit == 0)
+        {
+            GSORT_FN(heapsort)(array, left, right);
+            return;
+        }
+        depthLimit--;
+
+        ptrdiff_t split = GSORT_FN(partition)(array, left, right);
+        if (split - left < right - split)
+        {
+            GSORT_FN(introsort)(array, left, split, depthLimit);
+            left = split + 1;
+        }
+        else
+        {
+            GSORT_FN(introsort)(array, split + 1, right, depthLimit);
+            right = split;
+        }
+    }
+    GSORT_FN(insertion_sort)(array, left, right);
+}
+
+static void GSORT_FN(sequential)(GSORT_TYPE *array, ptrdiff_t size)
+{
+    int depthLimit = 0;
+    for (ptrdiff_t n = size; n > 1; n >>= 1)
+        depthLimit += 2;
+    if (size > 1)
+        GSORT_FN(introsort)(array, 0, size - 1, depthLimit);
+}
+
+#endif
+
+// Parallel sample sort. Splitters come from an oversampled random sample; all
+// workers then classify their share of the array into buckets in one pass,
+// scatter it with per-worker histogram prefix sums, and the buckets are sorted
+// independently.
+
+static ptrdiff_t GSORT_FN(part_start)(GSORT_FN(Shared) *shared, int part)
+{
+    ptrdiff_t size = shared->size;
+    int parts = shared->parts;
+    return size / parts * part + size % parts * part / parts;
+}
+
+static int GSORT_FN(classify)(const GSORT_FN(Shared) *shared, int step, GSORT_TYPE key)
+{
+    int pos = 0;
+    for (; step > 0; step >>= 1)
+    {
+        if (pos + step <= shared->splitterCount && GSORT_LESS(shared->splitters[pos + step - 1], key))
+            pos += step;
+    }
+    return 2 * pos + (pos < shared->splitterCount && !GSORT_LESS(key, shared->splitters[pos]));
+}
+
+static void GSORT_FN(classify_part)(void *arg, int part)
+{
+    GSORT_FN(Shared) *shared = (GSORT_FN(Shared) *)arg;
+    ptrdiff_t *count = &shared->counts[(ptrdiff_t)part * shared->buckets];
+    int step = 1;
+    while (step * 2 <= shared->splitterCount)
+        step *= 2;
+    if (shared->splitterCount == 0)
+        step = 0;
+    ptrdiff_t end = GSORT_FN(part_start)(shared, part + 1);
+    for (ptrdiff_t i = GSORT_FN(part_start)(shared, part); i < end; i++)
+    {
+        int b = GSORT_FN(classify)(shared, step, shared->array[i]);
+        shared->bucketOf[i] = (uint16_t)b;
+        count[b]++;
+    }
+}
+
+static void GSORT_FN(scatter_part)(void *arg, int part)
+{
+    GSORT_FN(Shared) *shared = (GSORT_FN(Shared) *)arg;
+    ptrdiff_t *offset = &shared->counts[(ptrdiff_t)part * shared->buckets];
+    ptrdiff_t end = GSORT_FN(part_start)(shared, part + 1);
+    for (ptrdiff_t i = GSORT_FN(part_start)(shared, part); i < end; i++)
+        shared->buffer[offset[shared->bucketOf[i]]++] = shared->array[i];
+}
+
+static void GSORT_FN(sort_bucket)(void *arg, int bucket)
+{
+    GSORT_FN(Shared) *shared = (GSORT_FN(Shared) *)arg;
+    ptrdiff_t start = shared->bucketStart[bucket];
+    ptrdiff_t end = shared->bucketStart[bucket + 1];
+    if (bucket % 2 == 0)
+        GSORT_FN(sequential)(shared->buffer + start, end - start);
+    memcpy(shared->array + start, shared->buffer + start, (size_t)(end - start) * sizeof(GSORT_TYPE));
+}
+
+static int GSORT_FN(choose_splitters)(const GSORT_TYPE *array, ptrdiff_t size, int wanted, GSORT_TYPE *splitters)
+{
+    int sampleSize = wanted * GSORT_OVERSAMPLING;
+    GSORT_TYPE *sample = (GSORT_TYPE *)malloc(sampleSize * sizeof(GSORT_TYPE));
+    uint64_t state = 88172645463325252ULL;
+    for (int i = 0; i < sampleSize; i++)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        sample[i] = array[state % (uint64_t)size];
+    }
+    GSORT_FN(sequential)(sample, sampleSize);
+
+    int count = 0;
+    for (int i = 1; i < wanted; i++)
+    {
+        GSORT_TYPE key = sample[i * GSORT_OVERSAMPLING];
+        if (count == 0 || GSORT_LESS(splitters[count - 1], key))
+            splitters[count++] = key;
+    }
+    free(sample);
+    return count;
+}
+
+void GSORT_CAT(gsort_, GSORT_SUFFIX)(SortPool *pool, GSORT_TYPE *array, ptrdiff_t size)
+{
+    int parts = pool != NULL ? pool_size(pool) : 1;
+    if (size < GSORT_PARALLEL_MIN || parts < 2)
+    {
+        GSORT_FN(sequential)(array, size);
+        return;
+    }
+
+    // At most 2 * wanted - 1 buckets must fit the 16-bit bucket ids
+    int wanted = parts * GSORT_BUCKETS_PER_WORKER;
+    if (wanted > 1 << 14)
+        wanted = 1 << 14;
+
+    GSORT_FN(Shared) shared;
+    shared.array = array;
+    shared.size = size;
+    shared.parts = parts;
+    shared.splitters = (GSORT_TYPE *)malloc(wanted * sizeof(GSORT_TYPE));
+    shared.splitterCount = GSORT_FN(choose_splitters)(array, size, wanted, shared.splitters);
+    shared.buckets = 2 * shared.splitterCount + 1;
+    shared.buffer = (GSORT_TYPE *)malloc((size_t)size * sizeof(GSORT_TYPE));
+    shared.bucketOf = (uint16_t *)malloc((size_t)size * sizeof(uint16_t));
+    shared.counts = (ptrdiff_t *)calloc((size_t)parts * shared.buckets, sizeof(ptrdiff_t));
+    shared.bucketStart = (ptrdiff_t *)malloc((shared.buckets + 1) * sizeof(ptrdiff_t));
+    if (shared.buffer == NULL || shared.bucketOf == NULL || shared.counts == NULL || shared.bucketStart == NULL)
+    {
+        // No room for the buffers: sort sequentially in place
+        GSORT_FN(sequential)(array, size);
+    }
+    else
+    {
+        pool_parallel_for(pool, parts, GSORT_FN(classify_part), &shared);
+
+        // Exclusive prefix sum, bucket-major: each part writes its share of a
+        // bucket right after the previous part's share
+        ptrdiff_t offset = 0;
+        for (int b = 0; b < shared.buckets; b++)
+        {
+            shared.bucketStart[b] = offset;
+            for (int p = 0; p < parts; p++)
+            {
+                ptrdiff_t count = shared.counts[(ptrdiff_t)p * shared.buckets + b];
+                shared.counts[(ptrdiff_t)p * shared.buckets + b] = offset;
+                offset += count;
+            }
+        }
+        shared.bucketStart[shared.buckets] = offset;
+
+        pool_parallel_for(pool, parts, GSORT_FN(scatter_part), &shared);
+        pool_parallel_for(pool, shared.buckets, GSORT_FN(sort_bucket), &shared);
+    }
+
+    free(shared.splitters);
+    free(shared.buffer);
+    free(shared.bucketOf);
+    free(shared.counts);
+    free(shared.bucketStart);
+}
+
+#undef GSORT_FN
+#undef GSORT_CAT
+#undef GSORT_CAT_
+#undef GSORT_SUFFIX
+#undef GSORT_TYPE
+#undef GSORT_LESS
+#undef GSORT_LEAF
@@ -0,0 +1,150 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "ioqueue.h"
+
+struct IoQueue
+{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t work;     // Signalled when a request is queued or on shutdown
+    pthread_cond_t finished; // Broadcast when a request is done
+    IoRequest *head;
+    IoRequest *tail;
+    bool shutdown;
+};
+
+// Transfer all of the request, retrying short transfers and EINTR
+static void perform(IoRequest *request)
+{
+    char *buffer = (char *)request->buffer;
+    size_t done = 0;
+    while (done < request->bytes)
+    {
+        ssize_t n;
+        size_t count = request->bytes - done;
+        if (request->offset >= 0)
+        {
+            off_t at = request->offset + (off_t)done;
+            n = request->write ? pwrite(request->fd, buffer + done, count, at)
+                               : pread(request->fd, buffer + done, count, at);
+        }
+        else
+        {
+            n = request->write ? write(request->fd, buffer + done, count) : read(request->fd, buffer + done, count);
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+        {
+            request->result = -1;
+            request->error = errno;
+            return;
+        }
+        if (n == 0)
+        {
+            if (request->write)
+            {
+                request->result = -1;
+                request->error = EIO;
+                return;
+            }
+            break; // End of file
+        }
+        done += (size_t)n;
+    }
+    request->result = (ssize_t)done;
+}
+
+static void *io_worker(void *arg)
+{
+    IoQueue *queue = (IoQueue *)arg;
+    pthread_mutex_lock(&queue->mutex);
+    while (1)
+    {
+        while (queue->head == NULL && !queue->shutdown)
+            pthread_cond_wait(&queue->work, &queue->mutex);
+        if (queue->head == NULL)
+            break;
+        IoRequest *request = queue->head;
+        queue->head = request->next;
+        if (queue->head == NULL)
+            queue->tail = NULL;
+        pthread_mutex_unlock(&queue->mutex);
+
+        perform(request);
+
+        pthread_mutex_lock(&queue->mutex);
+        request->done = 1;
+        pthread_cond_broadcast(&queue->finished);
+    }
+    pthread_mutex_unlock(&queue->mutex);
+    return NULL;
+}
+
+IoQueue *io_queue_create(void)
+{
+    IoQueue *queue = (IoQueue *)malloc(sizeof(IoQueue));
+    if (queue == NULL)
+        return NULL;
+    queue->head = NULL;
+    queue->tail = NULL;
+    queue->shutdown = false;
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->work, NULL);
+    pthread_cond_init(&queue->finished, NULL);
+    if (pthread_create(&queue->thread, NULL, io_worker, queue) != 0)
+    {
+        pthread_mutex_destroy(&queue->mutex);
+        pthread_cond_destroy(&queue->work);
+        pthread_cond_destroy(&queue->finished);
+        free(queue);
+        return NULL;
+    }
+    return queue;
+}
+
+void io_queue_destroy(IoQueue *queue)
+{
+    pthread_mutex_lock(&queue->mutex);
+    queue->shutdown = true;
+    pthread_cond_signal(&queue->work);
+    pthread_mutex_unlock(&queue->mutex);
+    pthread_join(queue->thread, NULL);
+    pthread_mutex_destroy(&queue->mutex);
+    pthread_cond_destroy(&queue->work);
+    pthread_cond_destroy(&queue->finished);
+    free(queue);
+}
+
+void io_submit(IoQueue *queue, IoRequest *request)
+{
+    request->done = 0;
+    request->result = 0;
+    request->error = 0;
+    request->next = NULL;
+    pthread_mutex_lock(&queue->mutex);
+    if (queue->tail != NULL)
+        queue->tail->next = request;
+    else
+        queue->head = request;
+    queue->tail = request;
+    pthread_cond_signal(&queue->work);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+ssize_t io_wait(IoQueue *queue, IoRequest *request)
+{
+    pthread_mutex_lock(&queue->mutex);
+    while (!request->done)
+        pthread_cond_wait(&queue->finished, &queue->mutex);
+    pthread_mutex_unlock(&queue->mutex);
+    if (request->result < 0)
+        errno = request->error;
+    return request->result;
+}
@@ -0,0 +1,38 @@
+#ifndef IOQUEUE_H
+#define IOQUEUE_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+// Asynchronous file I/O on one background thread. Requests run in submission
+// order, so sequential writes to a pipe keep their order; the caller keeps
+// computing until it needs a buffer back and waits on that request only.
+typedef struct IoQueue IoQueue;
+
+typedef struct IoRequest
+{
+    int fd;
+    void *buffer;
+    size_t bytes;
+    off_t offset; // pread/pwrite at this offset; -1 = read/write at the file position
+    int write;    // 0 = read, 1 = write
+
+    // Filled in by the queue
+    ssize_t result; // Bytes transferred (short only at end of file), or -1
+    int error;      // errno when result is -1
+    int done;
+    struct IoRequest *next;
+} IoRequest;
+
+IoQueue *io_queue_create(void);
+
+// Finish every submitted request, then stop the thread
+void io_queue_destroy(IoQueue *queue);
+
+// Queue a request; its buffer must stay untouched until io_wait() returns
+void io_submit(IoQueue *queue, IoRequest *request);
+
+// Wait for a submitted request; returns its result with errno set on failure
+ssize_t io_wait(IoQueue *queue, IoRequest *request);
+
+#endif
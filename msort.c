@@ -0,0 +1,219 @@
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "msort.h"
+#include "partition.h"
+
+#define MERGE_SORT_MIN (1 << 14) // Smaller arrays are sorted by the caller alone
+
+typedef struct
+{
+    int *array;
+    int *buffer;
+    ptrdiff_t size;
+    int parts;
+    ptrdiff_t *runStart; // parts + 1 run boundaries in array
+    ptrdiff_t *splits;   // (parts + 1) x parts: splits[r * parts + i] is the cut in run i for output part r
+} MergeShared;
+
+static ptrdiff_t output_start(MergeShared *shared, int part)
+{
+    return shared->size * part / shared->parts;
+}
+
+// First index in array[left..right) holding a key > value (strict: >= value)
+static ptrdiff_t bound(const int *array, ptrdiff_t left, ptrdiff_t right, int value, int strict)
+{
+    while (left < right)
+    {
+        ptrdiff_t mid = left + (right - left) / 2;
+        if (strict ? array[mid] < value : array[mid] <= value)
+            left = mid + 1;
+        else
+            right = mid;
+    }
+    return left;
+}
+
+// Phase 1: sort one run
+static void sort_run(void *arg, int part)
+{
+    MergeShared *shared = (MergeShared *)arg;
+    ptrdiff_t left = shared->runStart[part];
+    ptrdiff_t right = shared->runStart[part + 1] - 1;
+    if (left < right)
+        sequential_quicksort(shared->array, left, right);
+}
+
+// Phase 2: co-rank. Cut every run so that exactly rank keys lie before the cuts
+// and none of them is greater than a key after the cuts. Keys equal to the
+// splitter are taken from the lowest-numbered runs first, so every index cuts
+// the runs the same way and the outputs tile without gaps or overlaps.
+static void co_rank(void *arg, int index)
+{
+    MergeShared *shared = (MergeShared *)arg;
+    int parts = shared->parts;
+    int *array = shared->array;
+    ptrdiff_t *cut = &shared->splits[index * parts];
+    ptrdiff_t rank = output_start(shared, index);
+
+    if (rank == 0 || rank == shared->size)
+    {
+        for (int i = 0; i < parts; i++)
+            cut[i] = rank == 0 ? shared->runStart[i] : shared->runStart[i + 1];
+        return;
+    }
+
+    // Smallest key v with at least rank keys <= v
+    long low = INT_MAX, high = INT_MIN;
+    for (int i = 0; i < parts; i++)
+    {
+        if (shared->runStart[i] < shared->runStart[i + 1])
+        {
+            if (array[shared->runStart[i]] < low)
+                low = array[shared->runStart[i]];
+            if (array[shared->runStart[i + 1] - 1] > high)
+                high = array[shared->runStart[i + 1] - 1];
+        }
+    }
+    while (low < high)
+    {
+        long mid = low + (high - low) / 2;
+        ptrdiff_t atMost = 0;
+        for (int i = 0; i < parts; i++)
+            atMost += bound(array, shared->runStart[i], shared->runStart[i + 1], (int)mid, 0) - shared->runStart[i];
+        if (atMost >= rank)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+    int splitter = (int)low;
+
+    ptrdiff_t need = rank;
+    for (int i = 0; i < parts; i++)
+    {
+        cut[i] = bound(array, shared->runStart[i], shared->runStart[i + 1], splitter, 1);
+        need -= cut[i] - shared->runStart[i];
+    }
+    for (int i = 0; i < parts && need > 0; i++)
+    {
+        ptrdiff_t equal = bound(array, shared->runStart[i], shared->runStart[i + 1], splitter, 0) - cut[i];
+        ptrdiff_t take = equal < need ? equal : need;
+        cut[i] += take;
+        need -= take;
+    }
+}
+
+// Restore the min-heap below slot root; equal keys are broken by run number,
+// so the heap order is a strict one
+static void heap_down(int *heap, int count, int root, const ptrdiff_t *head, const int *array)
+{
+    int run = heap[root];
+    while (1)
+    {
+        int child = 2 * root + 1;
+        if (child >= count)
+            break;
+        if (child + 1 < count)
+        {
+            int a = array[head[heap[child]]], b = array[head[heap[child + 1]]];
+            if (b < a || (b == a && heap[child + 1] < heap[child]))
+                child++;
+        }
+        int c = array[head[heap[child]]], v = array[head[run]];
+        if (v < c || (v == c && run < heap[child]))
+            break;
+        heap[root] = heap[child];
+        root = child;
+    }
+    heap[root] = run;
+}
+
+// Phase 3: merge the slices of every run between two consecutive cuts into
+// this part's range of the buffer
+static void merge_part(void *arg, int part)
+{
+    MergeShared *shared = (MergeShared *)arg;
+    int parts = shared->parts;
+    int *array = shared->array;
+    ptrdiff_t *from = &shared->splits[part * parts];
+    ptrdiff_t *to = &shared->splits[(part + 1) * parts];
+    int *out = shared->buffer + output_start(shared, part);
+
+    ptrdiff_t *head = (ptrdiff_t *)malloc(parts * sizeof(ptrdiff_t));
+    int *heap = (int *)malloc(parts * sizeof(int));
+    int count = 0;
+    for (int i = 0; i < parts; i++)
+    {
+        head[i] = from[i];
+        if (from[i] < to[i])
+            heap[count++] = i;
+    }
+    for (int root = count / 2 - 1; root >= 0; root--)
+        heap_down(heap, count, root, head, array);
+
+    while (count > 1)
+    {
+        int run = heap[0];
+        *out++ = array[head[run]++];
+        if (head[run] == to[run])
+            heap[0] = heap[--count];
+        heap_down(heap, count, 0, head, array);
+    }
+    if (count == 1)
+    {
+        int run = heap[0];
+        memcpy(out, &array[head[run]], (size_t)(to[run] - head[run]) * sizeof(int));
+    }
+    free(head);
+    free(heap);
+}
+
+// Phase 4: copy this part's output back
+static void copy_back(void *arg, int part)
+{
+    MergeShared *shared = (MergeShared *)arg;
+    ptrdiff_t start = output_start(shared, part);
+    ptrdiff_t end = output_start(shared, part + 1);
+    memcpy(shared->array + start, shared->buffer + start, (size_t)(end - start) * sizeof(int));
+}
+
+void pool_merge_sort(SortPool *pool, int *array, ptrdiff_t size)
+{
+    int parts = pool_size(pool);
+    if (size < MERGE_SORT_MIN || parts < 2)
+    {
+        if (size > 1)
+            sequential_quicksort(array, 0, size - 1);
+        return;
+    }
+
+    MergeShared shared;
+    shared.array = array;
+    shared.size = size;
+    shared.parts = parts;
+    shared.buffer = (int *)malloc((size_t)size * sizeof(int));
+    shared.runStart = (ptrdiff_t *)malloc((parts + 1) * sizeof(ptrdiff_t));
+    shared.splits = (ptrdiff_t *)malloc((size_t)(parts + 1) * parts * sizeof(ptrdiff_t));
+    if (shared.buffer == NULL || shared.runStart == NULL || shared.splits == NULL)
+    {
+        // No room for the merge buffer: sort in place instead
+        free(shared.buffer);
+        free(shared.runStart);
+        free(shared.splits);
+        pool_sort(pool, array, size);
+        return;
+    }
+    for (int i = 0; i <= parts; i++)
+        shared.runStart[i] = output_start(&shared, i);
+
+    pool_parallel_for(pool, parts, sort_run, &shared);
+    pool_parallel_for(pool, parts + 1, co_rank, &shared);
+    pool_parallel_for(pool, parts, merge_part, &shared);
+    pool_parallel_for(pool, parts, copy_back, &shared);
+
+    free(shared.buffer);
+    free(shared.runStart);
+    free(shared.splits);
+}
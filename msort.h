@@ -0,0 +1,13 @@
+#ifndef MSORT_H
+#define MSORT_H
+
+#include "pool.h"
+
+// Parallel multiway merge sort. Each of the pool's P workers sorts one of P equal
+// chunks with sequential_quicksort(); the runs are then merged by a P-way merge in
+// which every worker writes its own 1/P of the output. Splitters are found by
+// co-ranking, so the split sizes do not depend on pivots or input order.
+// Needs a temporary copy of the array.
+void pool_merge_sort(SortPool *pool, int *array, ptrdiff_t size);
+
+#endif
@@ -0,0 +1,57 @@
+#ifndef NETWORK_H
+#define NETWORK_H
+
+#include <stddef.h>
+
+// Sorting networks for the leaves of every quicksort variant. Header-only so the
+// standalone programs can include it without linking partition.c.
+
+// Ranges of at most this many elements are finished by sort_network()
+#define NETWORK_MAX 32
+
+// Branch-free compare-exchange: afterwards arr[a] <= arr[b]. The ternaries
+// compile to min/max or conditional moves, never to a data-dependent jump.
+static inline void compare_exchange(int *arr, int a, int b)
+{
+    int x = arr[a];
+    int y = arr[b];
+    arr[a] = x < y ? x : y;
+    arr[b] = x < y ? y : x;
+}
+
+// Sort arr[left..right] with Batcher's merge-exchange network (Knuth, TAOCP
+// 5.2.2 Algorithm M), which works for any size. The comparator sequence only
+// depends on the size, so the loop branches are the same on every call.
+static inline void sort_network(int *arr, ptrdiff_t left, ptrdiff_t right)
+{
+    int n = (int)(right - left + 1);
+    if (n < 2)
+        return;
+
+    int t = 0;
+    while ((1 << t) < n)
+        t++;
+
+    int *base = arr + left;
+    for (int p = 1 << (t - 1); p > 0; p >>= 1)
+    {
+        int q = 1 << (t - 1);
+        int r = 0;
+        int d = p;
+        while (1)
+        {
+            for (int i = 0; i < n - d; i++)
+            {
+                if ((i & p) == r)
+                    compare_exchange(base, i, i + d);
+            }
+            if (q == p)
+                break;
+            d = q - p;
+            q >>= 1;
+            r = p;
+        }
+    }
+}
+
+#endif
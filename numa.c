@@ -0,0 +1,364 @@
+#define _GNU_SOURCE // sched_getaffinity() and pthread_attr_setaffinity_np()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "numa.h"
+
+#define MPOL_INTERLEAVE_POLICY 3 // MPOL_INTERLEAVE from <linux/mempolicy.h>, which libc does not wrap
+#define PREFAULT_THREADS_PER_NODE 8 // A few threads per node are enough to fault at full bandwidth
+#define NUMA_MAX_REGIONS 16      // First-touch arrays alive at once that numa_home_node() knows about
+
+NumaMode numaMode = NUMA_OFF;
+
+static const char *numaModeNames[NUMA_MODE_COUNT] = {"off", "interleave", "first_touch"};
+
+const char *numa_mode_name(NumaMode mode)
+{
+    return numaModeNames[mode];
+}
+
+int numa_mode_parse(const char *name)
+{
+    for (int i = 0; i < NUMA_MODE_COUNT; i++)
+    {
+        if (strcmp(name, numaModeNames[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static NumaTopology topology;
+static pthread_once_t topologyOnce = PTHREAD_ONCE_INIT;
+
+#ifdef __linux__
+// Mark the entries of a sysfs list such as "0-3,8-11" that are below count
+static int read_list(const char *path, unsigned char *set, int count)
+{
+    char line[4096];
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return -1;
+    if (fgets(line, sizeof(line), f) == NULL)
+        line[0] = '\0';
+    fclose(f);
+
+    const char *text = line;
+    while (1)
+    {
+        char *end;
+        long first = strtol(text, &end, 10);
+        if (end == text)
+            break;
+        long last = first;
+        if (*end == '-')
+        {
+            text = end + 1;
+            last = strtol(text, &end, 10);
+        }
+        for (long i = first < 0 ? 0 : first; i <= last && i < count; i++)
+            set[i] = 1;
+        if (*end != ',')
+            break;
+        text = end + 1;
+    }
+    return 0;
+}
+#endif
+
+static void add_cpu(int cpu, int node)
+{
+    topology.cpuIds[topology.cpus] = cpu;
+    topology.cpuNodes[topology.cpus] = node;
+    topology.cpus++;
+}
+
+static void read_topology(void)
+{
+    static unsigned char allowed[NUMA_MAX_CPUS];
+    int haveAffinity = 0;
+#ifdef __linux__
+    cpu_set_t mask;
+    if (sched_getaffinity(0, sizeof(mask), &mask) == 0)
+    {
+        haveAffinity = 1;
+        for (int cpu = 0; cpu < NUMA_MAX_CPUS && cpu < CPU_SETSIZE; cpu++)
+            allowed[cpu] = CPU_ISSET(cpu, &mask) != 0;
+    }
+
+    // Memory-only nodes have no CPUs to run on and are left out
+    unsigned char online[NUMA_MAX_NODES] = {0};
+    if (read_list("/sys/devices/system/node/online", online, NUMA_MAX_NODES) == 0)
+    {
+        for (int node = 0; node < NUMA_MAX_NODES; node++)
+        {
+            char path[64];
+            unsigned char cpus[NUMA_MAX_CPUS] = {0};
+            snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+            if (!online[node] || read_list(path, cpus, NUMA_MAX_CPUS) < 0)
+                continue;
+            int before = topology.cpus;
+            for (int cpu = 0; cpu < NUMA_MAX_CPUS; cpu++)
+            {
+                if (cpus[cpu] && (!haveAffinity || allowed[cpu]))
+                    add_cpu(cpu, topology.nodes);
+            }
+            if (topology.cpus > before)
+                topology.nodeIds[topology.nodes++] = node;
+        }
+    }
+#endif
+    if (topology.nodes == 0)
+    {
+        // No sysfs: one node holding every CPU we may use
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        topology.nodes = 1;
+        topology.nodeIds[0] = 0;
+        topology.cpus = 0;
+        for (int cpu = 0; cpu < NUMA_MAX_CPUS; cpu++)
+        {
+            if (haveAffinity ? allowed[cpu] : cpu < online)
+                add_cpu(cpu, 0);
+        }
+        if (topology.cpus == 0)
+            add_cpu(0, 0);
+    }
+}
+
+const NumaTopology *numa_topology(void)
+{
+    pthread_once(&topologyOnce, read_topology);
+    return &topology;
+}
+
+// Position of a node's first CPU in cpuIds and how many it has
+static int node_cpus(const NumaTopology *t, int node, int *first)
+{
+    int count = 0;
+    *first = -1;
+    for (int i = 0; i < t->cpus; i++)
+    {
+        if (t->cpuNodes[i] != node)
+            continue;
+        if (*first < 0)
+            *first = i;
+        count++;
+    }
+    return count;
+}
+
+// Append "a-b" or "a" for each run of consecutive CPUs of a node
+static size_t describe_node(const NumaTopology *t, int node, char *buffer, size_t length)
+{
+    size_t used = 0;
+    int first;
+    int count = node_cpus(t, node, &first);
+    for (int i = first; i < first + count && used < length;)
+    {
+        int j = i;
+        while (j + 1 < first + count && t->cpuIds[j + 1] == t->cpuIds[j] + 1)
+            j++;
+        int n = j > i ? snprintf(buffer + used, length - used, "%s%d-%d", i > first ? "," : "", t->cpuIds[i], t->cpuIds[j])
+                      : snprintf(buffer + used, length - used, "%s%d", i > first ? "," : "", t->cpuIds[i]);
+        used += n > 0 ? (size_t)n : 0;
+        i = j + 1;
+    }
+    return used < length ? used : length;
+}
+
+void numa_describe(char *buffer, size_t length)
+{
+    const NumaTopology *t = numa_topology();
+    if (length == 0)
+        return;
+    size_t used = (size_t)snprintf(buffer, length, "%d node%s:", t->nodes, t->nodes > 1 ? "s" : "");
+    for (int node = 0; node < t->nodes && used < length; node++)
+    {
+        int n = snprintf(buffer + used, length - used, "%s node%d cpus ", node > 0 ? "," : "", t->nodeIds[node]);
+        used += n > 0 ? (size_t)n : 0;
+        if (used < length)
+            used += describe_node(t, node, buffer + used, length - used);
+    }
+}
+
+int numa_worker_cpu(int index, int *node)
+{
+    const NumaTopology *t = numa_topology();
+    int first;
+    *node = index % t->nodes;
+    int count = node_cpus(t, *node, &first);
+    return t->cpuIds[first + index / t->nodes % count];
+}
+
+int numa_pin(pthread_attr_t *attr, int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_attr_setaffinity_np(attr, sizeof(set), &set) == 0 ? 0 : -1;
+#else
+    (void)attr;
+    (void)cpu;
+    return -1;
+#endif
+}
+
+typedef struct
+{
+    _Atomic uintptr_t begin; // 0 = free slot
+    _Atomic uintptr_t end;
+} Region;
+
+static Region regions[NUMA_MAX_REGIONS];
+
+int numa_home_node(const void *address)
+{
+    uintptr_t at = (uintptr_t)address;
+    for (int i = 0; i < NUMA_MAX_REGIONS; i++)
+    {
+        uintptr_t begin = atomic_load_explicit(&regions[i].begin, memory_order_acquire);
+        if (begin == 0 || at < begin)
+            continue;
+        uintptr_t end = atomic_load_explicit(&regions[i].end, memory_order_relaxed);
+        if (at < end)
+            return (int)((double)(at - begin) * topology.nodes / (end - begin));
+    }
+    return -1;
+}
+
+// Remember a first-touch array; beyond NUMA_MAX_REGIONS it just gets no home.
+// A reader racing with this sees no region or a wrong home, which is only a hint.
+static void add_region(void *memory, size_t bytes)
+{
+    for (int i = 0; i < NUMA_MAX_REGIONS; i++)
+    {
+        uintptr_t expected = 0;
+        if (atomic_compare_exchange_strong(&regions[i].begin, &expected, (uintptr_t)memory))
+        {
+            atomic_store(&regions[i].end, (uintptr_t)memory + bytes);
+            return;
+        }
+    }
+}
+
+static void remove_region(void *memory)
+{
+    for (int i = 0; i < NUMA_MAX_REGIONS; i++)
+    {
+        uintptr_t expected = (uintptr_t)memory;
+        if (atomic_compare_exchange_strong(&regions[i].begin, &expected, 0))
+        {
+            atomic_store(&regions[i].end, 0);
+            return;
+        }
+    }
+}
+
+typedef struct
+{
+    char *begin;
+    size_t bytes;
+    size_t page;
+} Prefault;
+
+// Write one byte per page: the page lands on the node of the CPU we run on
+static void *prefault(void *arg)
+{
+    Prefault *piece = (Prefault *)arg;
+    for (size_t at = 0; at < piece->bytes; at += piece->page)
+        piece->begin[at] = 0;
+    return NULL;
+}
+
+// Fault memory in by node-sized blocks, each split over threads pinned to that
+// node's CPUs. Without an interleave policy this is first touch.
+static void prefault_by_node(char *memory, size_t length, size_t page)
+{
+    const NumaTopology *t = numa_topology();
+    Prefault pieces[NUMA_MAX_NODES * PREFAULT_THREADS_PER_NODE];
+    pthread_t threads[NUMA_MAX_NODES * PREFAULT_THREADS_PER_NODE];
+    int started[NUMA_MAX_NODES * PREFAULT_THREADS_PER_NODE];
+    int count = 0;
+    size_t pages = length / page;
+    for (int node = 0; node < t->nodes; node++)
+    {
+        int first;
+        int cpus = node_cpus(t, node, &first);
+        int parts = cpus < PREFAULT_THREADS_PER_NODE ? cpus : PREFAULT_THREADS_PER_NODE;
+        size_t nodeBegin = pages * node / t->nodes, nodeEnd = pages * (node + 1) / t->nodes;
+        for (int part = 0; part < parts; part++)
+        {
+            size_t begin = nodeBegin + (nodeEnd - nodeBegin) * part / parts;
+            size_t end = nodeBegin + (nodeEnd - nodeBegin) * (part + 1) / parts;
+            pieces[count] = (Prefault){memory + begin * page, (end - begin) * page, page};
+
+            pthread_attr_t attr;
+            pthread_attr_init(&attr);
+            numa_pin(&attr, t->cpuIds[first + part]);
+            started[count] = pthread_create(&threads[count], &attr, prefault, &pieces[count]) == 0;
+            pthread_attr_destroy(&attr);
+            if (!started[count])
+                prefault(&pieces[count]);
+            count++;
+        }
+    }
+    for (int i = 0; i < count; i++)
+    {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+    }
+}
+
+static size_t page_length(size_t bytes, size_t *page)
+{
+    long size = sysconf(_SC_PAGESIZE);
+    *page = size > 0 ? (size_t)size : 4096;
+    return (bytes + *page - 1) / *page * *page;
+}
+
+void *numa_alloc(size_t bytes)
+{
+    size_t page;
+    size_t length = page_length(bytes > 0 ? bytes : 1, &page);
+    void *memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED)
+        return NULL;
+    if (numaMode == NUMA_OFF)
+        return memory;
+
+    const NumaTopology *t = numa_topology();
+#ifdef __linux__
+    if (numaMode == NUMA_INTERLEAVE && t->nodes > 1)
+    {
+        // On failure (no NUMA support in the kernel) the pages fall back to first touch
+        unsigned long nodes[(NUMA_MAX_NODES + 8 * sizeof(unsigned long) - 1) / (8 * sizeof(unsigned long))] = {0};
+        for (int node = 0; node < t->nodes; node++)
+            nodes[t->nodeIds[node] / (8 * sizeof(unsigned long))] |= 1UL << (t->nodeIds[node] % (8 * sizeof(unsigned long)));
+        syscall(SYS_mbind, memory, length, MPOL_INTERLEAVE_POLICY, nodes, (unsigned long)NUMA_MAX_NODES + 1, 0);
+    }
+#endif
+    prefault_by_node((char *)memory, length, page);
+    if (numaMode == NUMA_FIRST_TOUCH && t->nodes > 1)
+        add_region(memory, length);
+    return memory;
+}
+
+void numa_free(void *memory, size_t bytes)
+{
+    if (memory == NULL)
+        return;
+    size_t page;
+    remove_region(memory);
+    munmap(memory, page_length(bytes > 0 ? bytes : 1, &page));
+}
@@ -0,0 +1,63 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <stddef.h>
+#include <pthread.h>
+
+// NUMA placement for large sorts, without libnuma. The topology is read once
+// from /sys/devices/system/node, limited to the CPUs this process may run on.
+// Under a NUMA mode the pool pins its workers round-robin across the nodes,
+// numa_alloc() places an array's pages, and a worker out of work prefers to
+// steal ranges whose pages are on its own node. Hosts with one node, and
+// builds for anything but Linux, see a single node and nothing is pinned.
+
+#define NUMA_MAX_NODES 64
+#define NUMA_MAX_CPUS 1024
+
+typedef struct
+{
+    int nodes;                       // Nodes with CPUs we may use, at least 1
+    int nodeIds[NUMA_MAX_NODES];     // sysfs number of each node
+    int cpus;                        // CPUs we may use, node by node
+    int cpuIds[NUMA_MAX_CPUS];       // Kernel CPU number of each
+    int cpuNodes[NUMA_MAX_CPUS];     // Index into nodeIds of each
+} NumaTopology;
+
+typedef enum
+{
+    NUMA_OFF,         // malloc() and the kernel's default placement; workers float
+    NUMA_INTERLEAVE,  // Pages round-robin over the nodes; workers pinned
+    NUMA_FIRST_TOUCH, // Node-sized blocks of the array, each first touched on its
+                      // node in parallel; workers pinned and steal locally first
+    NUMA_MODE_COUNT
+} NumaMode;
+
+// Read by pool_create() and numa_alloc()
+extern NumaMode numaMode;
+
+const char *numa_mode_name(NumaMode mode);
+int numa_mode_parse(const char *name);
+
+// This host's topology, read on first use
+const NumaTopology *numa_topology(void);
+
+// One line such as "2 nodes: node0 cpus 0-15, node1 cpus 16-31"
+void numa_describe(char *buffer, size_t length);
+
+// CPU of pool worker index: round-robin over the nodes, so a pool smaller
+// than the host still spans them all. Stores that CPU's node index in *node.
+int numa_worker_cpu(int index, int *node);
+
+// Pin a thread attribute to one CPU; returns 0, or -1 where pinning is unsupported
+int numa_pin(pthread_attr_t *attr, int cpu);
+
+// Page-aligned memory for a large array, placed by numaMode and pre-faulted in
+// parallel. Returns NULL if it cannot be mapped. Release with numa_free().
+void *numa_alloc(size_t bytes);
+void numa_free(void *memory, size_t bytes);
+
+// Node index whose pages hold address under NUMA_FIRST_TOUCH, or -1 if it is
+// not in such an array (a hint: no lock is taken)
+int numa_home_node(const void *address);
+
+#endif
@@ -0,0 +1,514 @@
+#include <string.h>
+#include <stdatomic.h>
+
+#include "partition.h"
+#include "vpartition.h"
+#include "network.h"
+
+#define NINTHER_MIN 128      // Smallest range for which PIVOT_AUTO uses the ninther
+#define SAMPLE_MIN (1 << 16) // Smallest range for which PIVOT_AUTO samples
+#define PIVOT_SAMPLE_SIZE 63 // Elements in the sample, odd so the median is exact
+#define PARTITION_BLOCK 128  // Elements scanned per block by partition_block()
+
+PivotPolicy pivotPolicy = PIVOT_AUTO;
+PartitionKernel partitionKernel = KERNEL_HOARE;
+int smallThreshold = SMALL_THRESHOLD;
+int introsortEnabled = 1;
+int networkLeaves = 1;
+int splitStatsEnabled = 0;
+
+static atomic_long splitCount = 0;
+static atomic_long splitBalanceSum = 0; // Fixed point, 1e6 = perfectly balanced
+
+static const char *pivotPolicyNames[PIVOT_POLICY_COUNT] = {
+    "first", "middle", "median3", "ninther", "sample", "auto"};
+
+const char *pivot_policy_name(PivotPolicy policy)
+{
+    return pivotPolicyNames[policy];
+}
+
+int pivot_policy_parse(const char *name)
+{
+    for (int i = 0; i < PIVOT_POLICY_COUNT; i++)
+    {
+        if (strcmp(name, pivotPolicyNames[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+void record_split(ptrdiff_t size, ptrdiff_t leftSize)
+{
+    ptrdiff_t smaller = leftSize < size - leftSize ? leftSize : size - leftSize;
+    atomic_fetch_add_explicit(&splitCount, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&splitBalanceSum, (long)(2e6 * smaller / size), memory_order_relaxed);
+}
+
+void reset_split_stats(void)
+{
+    atomic_store(&splitCount, 0);
+    atomic_store(&splitBalanceSum, 0);
+}
+
+// Mean balance in [0, 1]: 1 means every split was an even halving
+double split_balance(long *splits)
+{
+    long count = atomic_load(&splitCount);
+    if (splits != NULL)
+        *splits = count;
+    if (count == 0)
+        return 0.0;
+    return atomic_load(&splitBalanceSum) / 1e6 / count;
+}
+
+// Swap two elements
+void swap(int *a, int *b)
+{
+    int temp = *a;
+    *a = *b;
+    *b = temp;
+}
+
+// Index of the median of arr[a], arr[b], arr[c]
+static ptrdiff_t median_of_three(int *arr, ptrdiff_t a, ptrdiff_t b, ptrdiff_t c)
+{
+    if (arr[a] < arr[b])
+    {
+        if (arr[b] < arr[c])
+            return b;
+        return arr[a] < arr[c] ? c : a;
+    }
+    if (arr[a] < arr[c])
+        return a;
+    return arr[b] < arr[c] ? c : b;
+}
+
+// Median of first, middle and last, sorting the three in place first.
+// The reorder keeps reversed input from turning into a bad pattern for later splits.
+static ptrdiff_t sorted_median_of_three(int *arr, ptrdiff_t low, ptrdiff_t high)
+{
+    ptrdiff_t mid = low + (high - low) / 2;
+    if (arr[mid] < arr[low])
+        swap(&arr[mid], &arr[low]);
+    if (arr[high] < arr[low])
+        swap(&arr[high], &arr[low]);
+    if (arr[high] < arr[mid])
+        swap(&arr[high], &arr[mid]);
+    return mid;
+}
+
+static ptrdiff_t ninther(int *arr, ptrdiff_t low, ptrdiff_t high)
+{
+    ptrdiff_t step = (high - low) / 8;
+    ptrdiff_t mid = low + (high - low) / 2;
+    ptrdiff_t a = median_of_three(arr, low, low + step, low + 2 * step);
+    ptrdiff_t b = median_of_three(arr, mid - step, mid, mid + step);
+    ptrdiff_t c = median_of_three(arr, high - 2 * step, high - step, high);
+    return median_of_three(arr, a, b, c);
+}
+
+// Median of evenly spaced elements, found by insertion-sorting their indices
+static ptrdiff_t sample_median(int *arr, ptrdiff_t low, ptrdiff_t high)
+{
+    ptrdiff_t index[PIVOT_SAMPLE_SIZE];
+    ptrdiff_t span = high - low;
+    for (int k = 0; k < PIVOT_SAMPLE_SIZE; k++)
+    {
+        ptrdiff_t idx = low + (ptrdiff_t)(span * k / (PIVOT_SAMPLE_SIZE - 1));
+        int j = k - 1;
+        while (j >= 0 && arr[index[j]] > arr[idx])
+        {
+            index[j + 1] = index[j];
+            j--;
+        }
+        index[j + 1] = idx;
+    }
+    return index[PIVOT_SAMPLE_SIZE / 2];
+}
+
+ptrdiff_t choose_pivot(int *arr, ptrdiff_t low, ptrdiff_t high)
+{
+    ptrdiff_t size = high - low + 1;
+    switch (pivotPolicy)
+    {
+    case PIVOT_FIRST:
+        return low;
+    case PIVOT_MIDDLE:
+        return low + (high - low) / 2;
+    case PIVOT_MEDIAN3:
+        return sorted_median_of_three(arr, low, high);
+    case PIVOT_NINTHER:
+        return size >= 9 ? ninther(arr, low, high) : sorted_median_of_three(arr, low, high);
+    case PIVOT_SAMPLE:
+        return size >= PIVOT_SAMPLE_SIZE ? sample_median(arr, low, high) : sorted_median_of_three(arr, low, high);
+    default:
+        if (size >= SAMPLE_MIN)
+            return sample_median(arr, low, high);
+        if (size >= NINTHER_MIN)
+            return ninther(arr, low, high);
+        return sorted_median_of_three(arr, low, high);
+    }
+}
+
+// Hoare partition loop around the pivot already placed at arr[low]; keeping
+// the pivot there guarantees the returned index is below high
+static ptrdiff_t hoare_from_low(int *arr, ptrdiff_t low, ptrdiff_t high)
+{
+    int pivot = arr[low];
+    ptrdiff_t i = low - 1, j = high + 1;
+
+    while (1)
+    {
+        do
+        {
+            i++;
+        } while (arr[i] < pivot);
+
+        do
+        {
+            j--;
+        } while (arr[j] > pivot);
+
+        if (i >= j)
+            break;
+
+        swap(&arr[i], &arr[j]);
+    }
+    if (splitStatsEnabled && high - low + 1 >= SPLIT_STATS_MIN)
+        record_split(high - low + 1, j - low + 1);
+    return j;
+}
+
+// Partition the array: Hoare partition around the pivot picked by pivotPolicy
+ptrdiff_t partition_hoare(int *arr, ptrdiff_t low, ptrdiff_t high)
+{
+    swap(&arr[low], &arr[choose_pivot(arr, low, high)]);
+    return hoare_from_low(arr, low, high);
+}
+
+// Partition the array: Hoare partition around the median of first, middle and last
+ptrdiff_t partition_median_of_three(int *arr, ptrdiff_t low, ptrdiff_t high)
+{
+    swap(&arr[low], &arr[sorted_median_of_three(arr, low, high)]);
+    return hoare_from_low(arr, low, high);
+}
+
+// Partition the array: Lomuto partition, with the chosen pivot moved to the end
+ptrdiff_t partition_lomuto(int *array, ptrdiff_t left, ptrdiff_t right)
+{
+    swap(&array[right], &array[choose_pivot(array, left, right)]);
+    int pivot = array[right];
+    ptrdiff_t i = left - 1;
+
+    for (ptrdiff_t j = left; j < right; j++)
+    {
+        if (array[j] < pivot)
+        {
+            i++;
+            swap(&array[i], &array[j]);
+        }
+    }
+    swap(&array[i + 1], &array[right]);
+    if (splitStatsEnabled && right - left + 1 >= SPLIT_STATS_MIN)
+        record_split(right - left + 1, i + 1 - left);
+    return i + 1;
+}
+
+// Partition the array: Bentley-McIlroy three-way partition. Keys equal to the
+// pivot are swapped to both ends while scanning and then moved to the middle,
+// so afterwards arr[low..*lessEnd] < pivot == arr[*lessEnd+1..*greaterStart-1]
+// < arr[*greaterStart..high]
+void partition_three_way(int *arr, ptrdiff_t low, ptrdiff_t high, ptrdiff_t *lessEnd, ptrdiff_t *greaterStart)
+{
+    if (high <= low)
+    {
+        *lessEnd = low - 1;
+        *greaterStart = high + 1;
+        return;
+    }
+    swap(&arr[low], &arr[choose_pivot(arr, low, high)]);
+    int pivot = arr[low];
+    ptrdiff_t i = low, j = high + 1;
+    ptrdiff_t p = low, q = high + 1; // arr[low..p] and arr[q..high] hold keys equal to the pivot
+
+    while (1)
+    {
+        while (arr[++i] < pivot)
+        {
+            if (i == high)
+                break;
+        }
+        while (pivot < arr[--j])
+        {
+            if (j == low)
+                break;
+        }
+        if (i == j && arr[i] == pivot)
+            swap(&arr[++p], &arr[i]);
+        if (i >= j)
+            break;
+
+        swap(&arr[i], &arr[j]);
+        if (arr[i] == pivot)
+            swap(&arr[++p], &arr[i]);
+        if (arr[j] == pivot)
+            swap(&arr[--q], &arr[j]);
+    }
+
+    // Bring the equal keys from both ends next to the split
+    i = j + 1;
+    for (ptrdiff_t k = low; k <= p; k++)
+        swap(&arr[k], &arr[j--]);
+    for (ptrdiff_t k = high; k >= q; k--)
+        swap(&arr[k], &arr[i++]);
+
+    if (splitStatsEnabled && high - low + 1 >= SPLIT_STATS_MIN)
+        record_split(high - low + 1, j - low + 1);
+    *lessEnd = j;
+    *greaterStart = i;
+}
+
+// Partition the array: BlockQuicksort-style block partition. Each side scans a
+// block of PARTITION_BLOCK elements and records the offsets of misplaced ones
+// with a branch-free counter; the offsets are then swapped pairwise, so the
+// data-dependent comparisons never steer a branch. Equal keys are misplaced on
+// both sides, which splits runs of duplicates evenly like Hoare does.
+ptrdiff_t partition_block(int *arr, ptrdiff_t low, ptrdiff_t high)
+{
+    swap(&arr[low], &arr[choose_pivot(arr, low, high)]);
+    int pivot = arr[low];
+
+    unsigned char offsetsLeft[PARTITION_BLOCK];
+    unsigned char offsetsRight[PARTITION_BLOCK];
+    int numLeft = 0, numRight = 0;     // Misplaced offsets still to swap
+    int startLeft = 0, startRight = 0; // First unswapped offset in each buffer
+    ptrdiff_t l = low + 1, r = high;   // arr[l..r] is not partitioned yet
+
+    while (r - l + 1 > 2 * PARTITION_BLOCK)
+    {
+        if (numLeft == 0)
+        {
+            startLeft = 0;
+            for (int i = 0; i < PARTITION_BLOCK; i++)
+            {
+                offsetsLeft[numLeft] = (unsigned char)i;
+                numLeft += arr[l + i] >= pivot;
+            }
+        }
+        if (numRight == 0)
+        {
+            startRight = 0;
+            for (int i = 0; i < PARTITION_BLOCK; i++)
+            {
+                offsetsRight[numRight] = (unsigned char)i;
+                numRight += pivot >= arr[r - i];
+            }
+        }
+
+        int num = numLeft < numRight ? numLeft : numRight;
+        for (int k = 0; k < num; k++)
+            swap(&arr[l + offsetsLeft[startLeft + k]], &arr[r - offsetsRight[startRight + k]]);
+        numLeft -= num;
+        numRight -= num;
+        startLeft += num;
+        startRight += num;
+
+        // A block with no misplaced elements left is done
+        if (numLeft == 0)
+            l += PARTITION_BLOCK;
+        if (numRight == 0)
+            r -= PARTITION_BLOCK;
+    }
+
+    // Finish the last two blocks or less with a scalar Hoare loop. Offsets still
+    // buffered point into arr[l..r], so they are simply scanned again.
+    ptrdiff_t i = l, j = r;
+    while (1)
+    {
+        while (i <= j && arr[i] < pivot)
+            i++;
+        while (i <= j && arr[j] > pivot)
+            j--;
+        if (i >= j)
+            break;
+        swap(&arr[i], &arr[j]);
+        i++;
+        j--;
+    }
+
+    // arr[low+1..i-1] <= pivot <= arr[i..high]: put the pivot between them
+    swap(&arr[low], &arr[i - 1]);
+    if (splitStatsEnabled && high - low + 1 >= SPLIT_STATS_MIN)
+        record_split(high - low + 1, i - 1 - low);
+    return i - 1;
+}
+
+static const char *partitionKernelNames[PARTITION_KERNEL_COUNT] = {
+    "hoare", "lomuto", "median_of_three", "three_way", "block", "vector"};
+
+const char *partition_kernel_name(PartitionKernel kernel)
+{
+    return partitionKernelNames[kernel];
+}
+
+int partition_kernel_parse(const char *name)
+{
+    for (int i = 0; i < PARTITION_KERNEL_COUNT; i++)
+    {
+        if (strcmp(name, partitionKernelNames[i]) == 0)
+            return i;
+    }
+    return -1;
+}
+
+void partition_range(int *arr, ptrdiff_t low, ptrdiff_t high, ptrdiff_t *leftEnd, ptrdiff_t *rightStart)
+{
+    ptrdiff_t p;
+    switch (partitionKernel)
+    {
+    case KERNEL_LOMUTO:
+        p = partition_lomuto(arr, low, high);
+        *leftEnd = p - 1;
+        *rightStart = p + 1;
+        break;
+    case KERNEL_MEDIAN_OF_THREE:
+        p = partition_median_of_three(arr, low, high);
+        *leftEnd = p;
+        *rightStart = p + 1;
+        break;
+    case KERNEL_THREE_WAY:
+        partition_three_way(arr, low, high, leftEnd, rightStart);
+        break;
+    case KERNEL_BLOCK:
+        p = partition_block(arr, low, high);
+        *leftEnd = p - 1;
+        *rightStart = p + 1;
+        break;
+    case KERNEL_VECTOR:
+        partition_vector(arr, low, high, leftEnd, rightStart);
+        break;
+    default:
+        p = partition_hoare(arr, low, high);
+        *leftEnd = p;
+        *rightStart = p + 1;
+        break;
+    }
+}
+
+// Function to perform insertion sort
+void insertion_sort(int *arr, ptrdiff_t left, ptrdiff_t right)
+{
+    for (ptrdiff_t i = left + 1; i <= right; i++)
+    {
+        int key = arr[i];
+        ptrdiff_t j = i - 1;
+        while (j >= left && arr[j] > key)
+        {
+            arr[j + 1] = arr[j];
+            j--;
+        }
+        arr[j + 1] = key;
+    }
+}
+
+void sort_leaf(int *arr, ptrdiff_t left, ptrdiff_t right)
+{
+    if (networkLeaves && right - left + 1 <= NETWORK_MAX)
+        sort_network(arr, left, right);
+    else
+        insertion_sort(arr, left, right);
+}
+
+// Restore the max-heap property below node root of the heap arr[base..base+size-1]
+static void sift_down(int *arr, ptrdiff_t base, ptrdiff_t root, ptrdiff_t size)
+{
+    int value = arr[base + root];
+    while (1)
+    {
+        ptrdiff_t child = 2 * root + 1;
+        if (child >= size)
+            break;
+        if (child + 1 < size && arr[base + child + 1] > arr[base + child])
+            child++;
+        if (arr[base + child] <= value)
+            break;
+        arr[base + root] = arr[base + child];
+        root = child;
+    }
+    arr[base + root] = value;
+}
+
+void heapsort_range(int *arr, ptrdiff_t left, ptrdiff_t right)
+{
+    ptrdiff_t size = right - left + 1;
+    for (ptrdiff_t root = size / 2 - 1; root >= 0; root--)
+        sift_down(arr, left, root, size);
+    for (ptrdiff_t end = size - 1; end > 0; end--)
+    {
+        swap(&arr[left], &arr[left + end]);
+        sift_down(arr, left, 0, end);
+    }
+}
+
+int introsort_depth_limit(ptrdiff_t size)
+{
+    int log2 = 0;
+    while (size > 1)
+    {
+        size >>= 1;
+        log2++;
+    }
+    return 2 * log2;
+}
+
+void introsort(int *array, ptrdiff_t left, ptrdiff_t right, int depthLimit)
+{
+    while (right - left + 1 > smallThreshold)
+    {
+        if (depthLimit == 0)
+        {
+            heapsort_range(array, left, right);
+            return;
+        }
+        depthLimit--;
+
+        // Recurse into the smaller half and loop on the larger one
+        ptrdiff_t leftEnd, rightStart;
+        partition_range(array, left, right, &leftEnd, &rightStart);
+        if (leftEnd - left < right - rightStart)
+        {
+            introsort(array, left, leftEnd, depthLimit);
+            left = rightStart;
+        }
+        else
+        {
+            introsort(array, rightStart, right, depthLimit);
+            right = leftEnd;
+        }
+    }
+    sort_leaf(array, left, right);
+}
+
+// Sequential quicksort for small subarrays
+void sequential_quicksort(int *array, ptrdiff_t left, ptrdiff_t right)
+{
+    if (introsortEnabled)
+    {
+        if (left < right)
+            introsort(array, left, right, introsort_depth_limit(right - left + 1));
+        return;
+    }
+    if (networkLeaves && right - left + 1 <= NETWORK_MAX)
+    {
+        sort_network(array, left, right);
+        return;
+    }
+    if (left < right)
+    {
+        ptrdiff_t leftEnd, rightStart;
+        partition_range(array, left, right, &leftEnd, &rightStart);
+        sequential_quicksort(array, left, leftEnd);
+        sequential_quicksort(array, rightStart, right);
+    }
+}
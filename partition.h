@@ -0,0 +1,111 @@
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include <stddef.h>
+
+// Indices and sizes are ptrdiff_t throughout, so arrays past 2^31 elements work
+
+// How partition kernels pick their pivot, selectable at runtime
+typedef enum
+{
+    PIVOT_FIRST,   // arr[low], the original choice
+    PIVOT_MIDDLE,  // arr[(low + high) / 2]
+    PIVOT_MEDIAN3, // Median of first, middle and last
+    PIVOT_NINTHER, // Tukey's ninther: median of three medians of three
+    PIVOT_SAMPLE,  // Median of PIVOT_SAMPLE_SIZE evenly spaced elements
+    PIVOT_AUTO,    // Median of 3, ninther or sample depending on range size
+    PIVOT_POLICY_COUNT
+} PivotPolicy;
+
+extern PivotPolicy pivotPolicy;
+
+// Partition kernel used by sequential_quicksort(), introsort and the pool
+typedef enum
+{
+    KERNEL_HOARE,           // partition_hoare()
+    KERNEL_LOMUTO,          // partition_lomuto()
+    KERNEL_MEDIAN_OF_THREE, // partition_median_of_three()
+    KERNEL_THREE_WAY,       // partition_three_way(), drops keys equal to the pivot
+    KERNEL_BLOCK,           // partition_block(), branch-free block partition
+    KERNEL_VECTOR,          // partition_vector(), AVX2/AVX-512 picked from CPUID
+    PARTITION_KERNEL_COUNT
+} PartitionKernel;
+
+extern PartitionKernel partitionKernel;
+
+const char *partition_kernel_name(PartitionKernel kernel);
+int partition_kernel_parse(const char *name);
+
+// Name of a policy as used on command lines and in CSV output
+const char *pivot_policy_name(PivotPolicy policy);
+
+// Parse a policy name; returns -1 if unknown
+int pivot_policy_parse(const char *name);
+
+// Index of the pivot for arr[low..high] under the current policy
+ptrdiff_t choose_pivot(int *arr, ptrdiff_t low, ptrdiff_t high);
+
+// Split balance statistics: smaller side / range size, averaged over every
+// partition of at least SPLIT_STATS_MIN elements while splitStatsEnabled is set
+#define SPLIT_STATS_MIN 4096
+extern int splitStatsEnabled;
+void record_split(ptrdiff_t size, ptrdiff_t leftSize);
+void reset_split_stats(void);
+double split_balance(long *splits);
+
+// Swap two elements
+void swap(int *a, int *b);
+
+// Partition the array: Hoare partition, returns the last index of the left half
+ptrdiff_t partition_hoare(int *arr, ptrdiff_t low, ptrdiff_t high);
+
+// Partition the array: Lomuto partition, returns the final index of the pivot
+ptrdiff_t partition_lomuto(int *array, ptrdiff_t left, ptrdiff_t right);
+
+// Partition the array: Hoare partition around the median of first, middle and last
+ptrdiff_t partition_median_of_three(int *arr, ptrdiff_t low, ptrdiff_t high);
+
+// Partition the array: three-way partition into < pivot, == pivot and > pivot.
+// arr[*lessEnd + 1..*greaterStart - 1] holds the keys equal to the pivot.
+void partition_three_way(int *arr, ptrdiff_t low, ptrdiff_t high, ptrdiff_t *lessEnd, ptrdiff_t *greaterStart);
+
+// Partition the array: branch-free block partition (BlockQuicksort), returns
+// the final index of the pivot like partition_lomuto()
+ptrdiff_t partition_block(int *arr, ptrdiff_t low, ptrdiff_t high);
+
+// Ranges of at most this many elements are leaves, finished by sort_leaf().
+// Matches NETWORK_MAX so every leaf fits a sorting network.
+#define SMALL_THRESHOLD 32
+extern int smallThreshold;
+
+// When set (the default), sequential_quicksort() runs as introsort
+extern int introsortEnabled;
+
+// Function to perform insertion sort on arr[left..right]
+void insertion_sort(int *arr, ptrdiff_t left, ptrdiff_t right);
+
+// When set (the default), leaves of up to NETWORK_MAX elements are finished
+// by a sorting network instead of insertion sort or further partitioning
+extern int networkLeaves;
+
+// Sort a leaf range of at most smallThreshold elements
+void sort_leaf(int *arr, ptrdiff_t left, ptrdiff_t right);
+
+// Heapsort of arr[left..right], the O(n log n) fallback of introsort
+void heapsort_range(int *arr, ptrdiff_t left, ptrdiff_t right);
+
+// Recursion depth after which introsort gives up on quicksort: 2 * floor(log2(size))
+int introsort_depth_limit(ptrdiff_t size);
+
+// Quicksort that switches to heapsort past depthLimit levels and finishes
+// small ranges with insertion sort; recursion depth stays O(log n)
+void introsort(int *array, ptrdiff_t left, ptrdiff_t right, int depthLimit);
+
+// Partition arr[low..high] with the selected kernel. Both arr[low..*leftEnd]
+// and arr[*rightStart..high] still need sorting; anything in between is final.
+void partition_range(int *arr, ptrdiff_t low, ptrdiff_t high, ptrdiff_t *leftEnd, ptrdiff_t *rightStart);
+
+// Sequential quicksort for small subarrays
+void sequential_quicksort(int *array, ptrdiff_t left, ptrdiff_t right);
+
+#endif
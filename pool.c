@@ -0,0 +1,621 @@
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sched.h>
+
+#include "pool.h"
+#include "partition.h"
+#include "ppartition.h"
+#include "profile.h"
+#include "numa.h"
+
+#define POOL_THRESHOLD 10000 // Default size below which a range is sorted sequentially
+// Slots in each worker's deque (power of two). A sort keeps at most one pending
+// task per split level, and introsort's 2 * log2(size) levels stay below 128 for
+// any 64-bit size, so the deque only fills up under pool_parallel_for() pieces.
+#define DEQUE_CAPACITY 256
+#define PARALLEL_PARTITION_MIN (1 << 18) // Smallest range partitioned by several workers
+
+// One pool_sort() or pool_parallel_for() call; lives on the caller's stack
+typedef struct
+{
+    atomic_long pendingTasks; // Tasks pushed but not finished yet
+    atomic_bool finished;     // Set by whoever finishes the last task
+    bool sleeping;            // Caller sleeps on done instead of helping the workers
+    pthread_mutex_t mutex;
+    pthread_cond_t done;
+} Job;
+
+typedef struct Task
+{
+    int *array;
+    ptrdiff_t left;
+    ptrdiff_t right;
+    int threads;    // Workers this range may use for a cooperative partition
+    int depthLimit; // Splits left before the range is handed to introsort
+
+    // Set for a pool_parallel_for() piece instead of a range to sort
+    void (*run)(void *arg, int index);
+    void *arg;
+    int index;
+
+    Job *job;
+    struct Task *next; // Link in the injection queue
+} Task;
+
+// Per-worker Chase-Lev deque: the owner pushes and pops at the bottom,
+// idle workers steal the oldest (largest) range from the top
+typedef struct
+{
+    atomic_long top;
+    atomic_long bottom;
+    _Atomic(Task *) slots[DEQUE_CAPACITY];
+    _Atomic ptrdiff_t sizes[DEQUE_CAPACITY]; // Range length of each slot, read by thieves
+    _Atomic int homes[DEQUE_CAPACITY];       // NUMA node holding each slot's range, -1 if none
+} Deque;
+
+typedef struct
+{
+    SortPool *pool;
+    int id;
+    int node; // NUMA node index of the CPU it is pinned to, 0 if not pinned
+    pthread_t thread;
+    Deque deque;
+} Worker;
+
+struct SortPool
+{
+    int nthreads;
+    int started; // Workers whose thread is running, joined by pool_destroy()
+    int threshold;
+    bool placed; // Created under a NUMA mode: workers pinned, steals prefer their own node
+    Worker *workers;
+
+    // Root tasks submitted by pool_sort() callers, taken by the first free worker
+    Task *injectHead;
+    Task *injectTail;
+    atomic_int injectedCount;
+
+    atomic_int sleepingWorkers;
+    bool shutdown;
+    pthread_mutex_t mutex; // Guards the injection queue, shutdown and worker sleep/wake
+    pthread_cond_t cond;   // Signalled when new work is pushed
+};
+
+static _Thread_local Worker *currentWorker = NULL; // Set on pool worker threads
+
+// Push a task on the owner's end of the deque; fails when the deque is full
+static bool deque_push(Deque *deque, Task *task, int home)
+{
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    if (b - t >= DEQUE_CAPACITY)
+        return false;
+    atomic_store_explicit(&deque->sizes[b & (DEQUE_CAPACITY - 1)], task->right - task->left + 1, memory_order_relaxed);
+    atomic_store_explicit(&deque->homes[b & (DEQUE_CAPACITY - 1)], home, memory_order_relaxed);
+    atomic_store_explicit(&deque->slots[b & (DEQUE_CAPACITY - 1)], task, memory_order_relaxed);
+    atomic_store_explicit(&deque->bottom, b + 1, memory_order_release);
+    return true;
+}
+
+// Pop the most recently pushed task (owner only)
+static Task *deque_pop(Deque *deque)
+{
+    long b = atomic_load_explicit(&deque->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&deque->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&deque->top, memory_order_relaxed);
+    if (t > b)
+    {
+        // Deque was already empty
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+    Task *task = atomic_load_explicit(&deque->slots[b & (DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    if (t == b)
+    {
+        // Last element: race against thieves for it
+        if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+                                                     memory_order_seq_cst, memory_order_relaxed))
+            task = NULL;
+        atomic_store_explicit(&deque->bottom, b + 1, memory_order_relaxed);
+    }
+    return task;
+}
+
+// Steal the oldest task from another worker's deque; NULL if empty or lost the race
+static Task *deque_steal(Deque *deque)
+{
+    long t = atomic_load_explicit(&deque->top, memory_order_acquire);
+    atomic_thread_fence(memory_order_seq_cst);
+    long b = atomic_load_explicit(&deque->bottom, memory_order_acquire);
+    if (t >= b)
+        return NULL;
+    Task *task = atomic_load_explicit(&deque->slots[t & (DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    if (!atomic_compare_exchange_strong_explicit(&deque->top, &t, t + 1,
+                                                 memory_order_seq_cst, memory_order_relaxed))
+        return NULL;
+    return task;
+}
+
+// Size and home node of the range at the top of a deque, 0 if empty (racy hints for stealing)
+static ptrdiff_t deque_top_size(Deque *deque, int *home)
+{
+    long t = atomic_load(&deque->top);
+    long b = atomic_load(&deque->bottom);
+    if (t >= b)
+        return 0;
+    *home = atomic_load_explicit(&deque->homes[t & (DEQUE_CAPACITY - 1)], memory_order_relaxed);
+    return atomic_load_explicit(&deque->sizes[t & (DEQUE_CAPACITY - 1)], memory_order_relaxed);
+}
+
+// Steal from the worker whose oldest pending range is the largest. Ranges
+// whose pages are on our own node, or on no node in particular, come first.
+static Task *steal_largest(SortPool *pool, int self)
+{
+    int node = pool->workers[self].node;
+    for (int attempt = 0; attempt < 4; attempt++)
+    {
+        int victim = -1, localVictim = -1;
+        ptrdiff_t victimSize = 0, localSize = 0;
+        for (int i = 0; i < pool->nthreads; i++)
+        {
+            if (i == self)
+                continue;
+            int home = -1;
+            ptrdiff_t size = deque_top_size(&pool->workers[i].deque, &home);
+            if (size > victimSize)
+            {
+                victim = i;
+                victimSize = size;
+            }
+            if ((home < 0 || home == node) && size > localSize)
+            {
+                localVictim = i;
+                localSize = size;
+            }
+        }
+        if (localVictim >= 0)
+            victim = localVictim;
+        if (victim < 0)
+            return NULL;
+        Task *task = deque_steal(&pool->workers[victim].deque);
+        if (task != NULL)
+            return task;
+    }
+    return NULL;
+}
+
+// Take the oldest root task submitted by a caller
+static Task *take_injected(SortPool *pool)
+{
+    if (atomic_load(&pool->injectedCount) == 0)
+        return NULL;
+    pthread_mutex_lock(&pool->mutex);
+    Task *task = pool->injectHead;
+    if (task != NULL)
+    {
+        pool->injectHead = task->next;
+        if (pool->injectHead == NULL)
+            pool->injectTail = NULL;
+        atomic_fetch_sub(&pool->injectedCount, 1);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return task;
+}
+
+// Whether any deque or the injection queue holds work
+static bool work_available(SortPool *pool)
+{
+    if (atomic_load(&pool->injectedCount) > 0)
+        return true;
+    for (int i = 0; i < pool->nthreads; i++)
+    {
+        Deque *deque = &pool->workers[i].deque;
+        if (atomic_load(&deque->top) < atomic_load(&deque->bottom))
+            return true;
+    }
+    return false;
+}
+
+// Wake one sleeping worker, if any, after work was published
+static void wake_worker(SortPool *pool)
+{
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_load(&pool->sleepingWorkers) > 0)
+    {
+        pthread_mutex_lock(&pool->mutex);
+        pthread_cond_signal(&pool->cond);
+        pthread_mutex_unlock(&pool->mutex);
+    }
+}
+
+static void job_init(Job *job, long pendingTasks, bool sleeping)
+{
+    atomic_init(&job->pendingTasks, pendingTasks);
+    atomic_init(&job->finished, false);
+    job->sleeping = sleeping;
+    if (sleeping)
+    {
+        pthread_mutex_init(&job->mutex, NULL);
+        pthread_cond_init(&job->done, NULL);
+    }
+}
+
+// Mark one task finished and wake the caller once the whole job is done
+static void finish_task(Job *job)
+{
+    if (atomic_fetch_sub(&job->pendingTasks, 1) == 1)
+    {
+        if (!job->sleeping)
+        {
+            // The waiting worker polls the flag; this store is our last touch of job
+            atomic_store(&job->finished, true);
+            return;
+        }
+        pthread_mutex_lock(&job->mutex);
+        atomic_store(&job->finished, true);
+        pthread_cond_broadcast(&job->done);
+        pthread_mutex_unlock(&job->mutex);
+    }
+}
+
+// Add a task to the injection queue, for submissions from outside the pool
+static void inject_task(SortPool *pool, Task *task)
+{
+    pthread_mutex_lock(&pool->mutex);
+    if (pool->injectTail != NULL)
+        pool->injectTail->next = task;
+    else
+        pool->injectHead = task;
+    pool->injectTail = task;
+    atomic_fetch_add(&pool->injectedCount, 1);
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+}
+
+static void run_task(Worker *self, Task *task);
+
+// Publish a task on our own deque, or run it right away if the deque is full
+static void push_task(Worker *self, Task *task)
+{
+    atomic_fetch_add(&task->job->pendingTasks, 1);
+    int home = -1;
+    if (self->pool->placed && task->run == NULL)
+        home = numa_home_node(task->array + task->left + (task->right - task->left) / 2);
+    if (!deque_push(&self->deque, task, home))
+    {
+        run_task(self, task);
+        return;
+    }
+    wake_worker(self->pool);
+}
+
+// Run other tasks until the job is done, so a waiting worker never idles
+static void help_until_finished(Worker *self, Job *job)
+{
+    while (!atomic_load(&job->finished))
+    {
+        Task *task = deque_pop(&self->deque);
+        if (task == NULL)
+            task = steal_largest(self->pool, self->id);
+        if (task == NULL)
+            task = take_injected(self->pool);
+        if (task != NULL)
+            run_task(self, task);
+        else
+            sched_yield();
+    }
+}
+
+// Sleep until the job is done (callers that are not pool workers)
+static void sleep_until_finished(Job *job)
+{
+    pthread_mutex_lock(&job->mutex);
+    while (!atomic_load(&job->finished))
+    {
+        pthread_cond_wait(&job->done, &job->mutex);
+    }
+    pthread_mutex_unlock(&job->mutex);
+    pthread_mutex_destroy(&job->mutex);
+    pthread_cond_destroy(&job->done);
+}
+
+// Workers handed to a half of size keys next to one of otherSize, in double so
+// the product cannot overflow whatever the range length
+static int thread_share(int threads, ptrdiff_t size, ptrdiff_t otherSize)
+{
+    return (int)((double)threads * size / (size + otherSize));
+}
+
+// Sort a range, pushing the larger half of every split onto our own deque.
+// While a range still owns several workers' share, it is partitioned by all of them.
+static void sort_range(Worker *self, int *array, ptrdiff_t left, ptrdiff_t right, int threads, int depthLimit,
+                       Job *job)
+{
+    SortPool *pool = self->pool;
+    while (right - left >= pool->threshold && depthLimit > 0)
+    {
+        depthLimit--;
+
+        // array[leftEnd+1..rightStart-1] is final after the split (keys equal
+        // to the pivot under the three-way kernel) and gets no task
+        ptrdiff_t leftEnd, rightStart;
+        if (threads > 1 && right - left >= PARALLEL_PARTITION_MIN)
+        {
+            int pivot = array[choose_pivot(array, left, right)];
+            if (partitionKernel == KERNEL_THREE_WAY)
+            {
+                parallel_partition_three_way(pool, array, left, right, pivot, threads, &leftEnd, &rightStart);
+            }
+            else
+            {
+                leftEnd = parallel_partition(pool, array, left, right, pivot, threads) - 1;
+                rightStart = leftEnd + 1;
+                if (leftEnd == right)
+                    partition_range(array, left, right, &leftEnd, &rightStart); // Every key equal
+            }
+        }
+        else
+        {
+            partition_range(array, left, right, &leftEnd, &rightStart);
+        }
+
+        // Keep the smaller half, publish the larger one for thieves.
+        // The thread share follows the size of each half.
+        ptrdiff_t leftSize = leftEnd - left + 1;
+        ptrdiff_t rightSize = right - rightStart + 1;
+        if (leftSize < 2 || rightSize < 2)
+        {
+            // Nothing worth a task on one side: carry on with the other
+            if (leftSize >= rightSize)
+                right = leftEnd;
+            else
+                left = rightStart;
+            continue;
+        }
+        Task *half = (Task *)malloc(sizeof(Task));
+        if (half == NULL)
+        {
+            // No task to be had: sort the larger half here, the smaller one next
+            if (leftSize > rightSize)
+            {
+                introsort(array, left, leftEnd, depthLimit);
+                left = rightStart;
+            }
+            else
+            {
+                introsort(array, rightStart, right, depthLimit);
+                right = leftEnd;
+            }
+            continue;
+        }
+        if (leftSize > rightSize)
+        {
+            int given = thread_share(threads, leftSize, rightSize);
+            *half = (Task){array, left, leftEnd, given > 0 ? given : 1, depthLimit, NULL, NULL, 0, job, NULL};
+            left = rightStart;
+            threads = threads - given > 0 ? threads - given : 1;
+        }
+        else
+        {
+            int given = thread_share(threads, rightSize, leftSize);
+            *half = (Task){array, rightStart, right, given > 0 ? given : 1, depthLimit, NULL, NULL, 0, job, NULL};
+            right = leftEnd;
+            threads = threads - given > 0 ? threads - given : 1;
+        }
+        push_task(self, half);
+    }
+
+    // Small enough, or the splits went bad: introsort bounds the rest
+    if (introsortEnabled || depthLimit == 0)
+        introsort(array, left, right, depthLimit);
+    else
+        sequential_quicksort(array, left, right);
+}
+
+static void run_task(Worker *self, Task *task)
+{
+    Job *job = task->job;
+    if (task->run != NULL)
+        task->run(task->arg, task->index);
+    else
+        sort_range(self, task->array, task->left, task->right, task->threads, task->depthLimit, job);
+    free(task);
+    finish_task(job);
+}
+
+// Worker loop: own deque first, then callers' submissions, then steal
+static void *worker(void *arg)
+{
+    Worker *self = (Worker *)arg;
+    SortPool *pool = self->pool;
+    currentWorker = self;
+    while (1)
+    {
+        Task *task = deque_pop(&self->deque);
+        if (task == NULL)
+            task = take_injected(pool);
+        if (task == NULL)
+            task = steal_largest(pool, self->id);
+        if (task != NULL)
+        {
+            run_task(self, task);
+            continue;
+        }
+
+        // Nothing to do: park until someone pushes work or the pool shuts down
+        pthread_mutex_lock(&pool->mutex);
+        atomic_fetch_add(&pool->sleepingWorkers, 1);
+        while (!pool->shutdown && !work_available(pool))
+        {
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+        }
+        atomic_fetch_sub(&pool->sleepingWorkers, 1);
+        bool stop = pool->shutdown;
+        pthread_mutex_unlock(&pool->mutex);
+        if (stop)
+            break;
+    }
+    return NULL;
+}
+
+SortPool *pool_create(int nthreads)
+{
+    // The host profile, if any, replaces the built-in defaults
+    const SortProfile *profile = host_profile();
+    if (nthreads <= 0 && profile != NULL)
+        nthreads = profile->threads;
+    if (nthreads <= 0)
+        nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads <= 0)
+        nthreads = 1;
+
+    SortPool *pool = (SortPool *)calloc(1, sizeof(SortPool));
+    if (pool == NULL)
+        return NULL;
+    pool->nthreads = nthreads;
+    pool->placed = numaMode != NUMA_OFF;
+    pool->threshold = POOL_THRESHOLD;
+    if (profile != NULL && profile->poolThreshold > 0)
+        pool->threshold = profile->poolThreshold;
+    pool->workers = (Worker *)calloc(nthreads, sizeof(Worker));
+    if (pool->workers == NULL)
+    {
+        free(pool);
+        return NULL;
+    }
+    atomic_init(&pool->injectedCount, 0);
+    atomic_init(&pool->sleepingWorkers, 0);
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+
+    for (int i = 0; i < nthreads; i++)
+    {
+        Worker *w = &pool->workers[i];
+        w->pool = pool;
+        w->id = i;
+        atomic_init(&w->deque.top, 0);
+        atomic_init(&w->deque.bottom, 0);
+    }
+    for (int i = 0; i < nthreads; i++)
+    {
+        // Under a NUMA mode each worker is pinned from its first instruction on
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        if (pool->placed)
+            numa_pin(&attr, numa_worker_cpu(i, &pool->workers[i].node));
+        int error = pthread_create(&pool->workers[i].thread, &attr, worker, &pool->workers[i]);
+        pthread_attr_destroy(&attr);
+        if (error != 0)
+        {
+            // Stop the workers already running; the rest never existed
+            pool_destroy(pool);
+            return NULL;
+        }
+        pool->started++;
+    }
+    return pool;
+}
+
+void pool_sort(SortPool *pool, int *array, ptrdiff_t size)
+{
+    if (size < 2)
+        return;
+    if (size < pool->threshold)
+    {
+        // Not worth a round trip through the pool
+        sequential_quicksort(array, 0, size - 1);
+        return;
+    }
+
+    Job job;
+    job_init(&job, 1, true);
+
+    // Queue the root task for the first free worker, then sleep until it is sorted
+    Task *root = (Task *)malloc(sizeof(Task));
+    if (root == NULL)
+    {
+        sequential_quicksort(array, 0, size - 1);
+        return;
+    }
+    *root = (Task){array, 0, size - 1, pool->nthreads, introsort_depth_limit(size), NULL, NULL, 0, &job, NULL};
+    inject_task(pool, root);
+    sleep_until_finished(&job);
+}
+
+void pool_parallel_for(SortPool *pool, int count, void (*run)(void *arg, int index), void *arg)
+{
+    if (count <= 0)
+        return;
+
+    Worker *self = currentWorker;
+    if (self != NULL && self->pool != pool)
+        self = NULL; // A worker of another pool counts as an outside caller
+
+    Job job;
+    job_init(&job, 0, self == NULL);
+
+    // Publish pieces 1..count-1 and run piece 0 on the calling thread
+    atomic_fetch_add(&job.pendingTasks, 1);
+    for (int i = count - 1; i >= 1; i--)
+    {
+        Task *task = (Task *)malloc(sizeof(Task));
+        if (task == NULL)
+        {
+            run(arg, i); // No task to be had: run the piece here
+            continue;
+        }
+        *task = (Task){NULL, 0, 0, 1, 0, run, arg, i, &job, NULL};
+        if (self != NULL)
+        {
+            push_task(self, task);
+        }
+        else
+        {
+            atomic_fetch_add(&job.pendingTasks, 1);
+            inject_task(pool, task);
+        }
+    }
+    run(arg, 0);
+    finish_task(&job);
+
+    if (self != NULL)
+        help_until_finished(self, &job);
+    else
+        sleep_until_finished(&job);
+}
+
+void pool_set_threshold(SortPool *pool, int threshold)
+{
+    pool->threshold = threshold > 1 ? threshold : 2;
+}
+
+int pool_threshold(SortPool *pool)
+{
+    return pool->threshold;
+}
+
+int pool_size(SortPool *pool)
+{
+    return pool->nthreads;
+}
+
+void pool_destroy(SortPool *pool)
+{
+    pthread_mutex_lock(&pool->mutex);
+    pool->shutdown = true;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int i = 0; i < pool->started; i++)
+    {
+        pthread_join(pool->workers[i].thread, NULL);
+    }
+    pthread_mutex_destroy(&pool->mutex);
+    pthread_cond_destroy(&pool->cond);
+    free(pool->workers);
+    free(pool);
+}
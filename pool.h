@@ -0,0 +1,32 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+// Long-lived work-stealing thread pool for sorting. Workers stay parked
+// between calls, and pool_sort() may be called from several threads at once.
+typedef struct SortPool SortPool;
+
+// Start a pool with nthreads workers (0 = the host profile's count, else one per
+// online core). The threshold also comes from the host profile if there is one.
+// Returns NULL if the pool or one of its threads cannot be created.
+SortPool *pool_create(int nthreads);
+
+// Sort array[0..size-1] in place; returns once the whole range is sorted
+void pool_sort(SortPool *pool, int *array, ptrdiff_t size);
+
+// Run run(arg, i) for every i in [0, count) on the pool and return when all are done.
+// Safe to call from inside a pool task: the calling worker helps instead of blocking.
+void pool_parallel_for(SortPool *pool, int count, void (*run)(void *arg, int index), void *arg);
+
+// Ranges shorter than this are sorted by a single worker
+void pool_set_threshold(SortPool *pool, int threshold);
+int pool_threshold(SortPool *pool);
+
+// Number of worker threads in the pool
+int pool_size(SortPool *pool);
+
+// Stop and join the workers; no pool_sort() may be in flight
+void pool_destroy(SortPool *pool);
+
+#endif
@@ -0,0 +1,234 @@
+#include <stdlib.h>
+
+#include "ppartition.h"
+#include "partition.h"
+
+// Misplaced elements of one block: [start, start + length)
+typedef struct
+{
+    ptrdiff_t start;
+    ptrdiff_t length;
+} Interval;
+
+typedef struct
+{
+    int *array;
+    ptrdiff_t left;
+    ptrdiff_t right;
+    int pivot;
+    int parts;
+    int strict; // 1: small means < pivot, 0: small means <= pivot
+
+    ptrdiff_t *smallCount; // Per block, number of small elements after the local pass
+
+    // Swap phase: large elements left of the split and small elements right of it
+    Interval *wrongLeft;
+    Interval *wrongRight;
+    int wrongLeftCount;
+    int wrongRightCount;
+    ptrdiff_t misplaced;
+} PartitionShared;
+
+static ptrdiff_t block_start(PartitionShared *shared, int block)
+{
+    ptrdiff_t size = shared->right - shared->left + 1;
+    return shared->left + size * block / shared->parts;
+}
+
+static int is_small(int value, int pivot, int strict)
+{
+    return strict ? value < pivot : value <= pivot;
+}
+
+// Phase 1: each worker partitions its own block in place
+static void partition_own_block(void *arg, int block)
+{
+    PartitionShared *shared = (PartitionShared *)arg;
+    int *array = shared->array;
+    int pivot = shared->pivot;
+    int strict = shared->strict;
+    ptrdiff_t i = block_start(shared, block);
+    ptrdiff_t j = block_start(shared, block + 1) - 1;
+    ptrdiff_t first = i;
+
+    while (1)
+    {
+        while (i <= j && is_small(array[i], pivot, strict))
+            i++;
+        while (i <= j && !is_small(array[j], pivot, strict))
+            j--;
+        if (i >= j)
+            break;
+        int temp = array[i];
+        array[i] = array[j];
+        array[j] = temp;
+        i++;
+        j--;
+    }
+    shared->smallCount[block] = i - first;
+}
+
+// Find the interval holding the rank-th misplaced element and the offset into it
+static void locate(Interval *intervals, int count, ptrdiff_t rank, int *index, ptrdiff_t *offset)
+{
+    int k = 0;
+    while (k < count - 1 && rank >= intervals[k].length)
+    {
+        rank -= intervals[k].length;
+        k++;
+    }
+    *index = k;
+    *offset = rank;
+}
+
+// Phase 2: each worker swaps an equal share of the misplaced pairs
+static void swap_misplaced(void *arg, int part)
+{
+    PartitionShared *shared = (PartitionShared *)arg;
+    ptrdiff_t from = shared->misplaced * part / shared->parts;
+    ptrdiff_t to = shared->misplaced * (part + 1) / shared->parts;
+    if (from >= to)
+        return;
+
+    int li, ri;
+    ptrdiff_t lo, ro;
+    locate(shared->wrongLeft, shared->wrongLeftCount, from, &li, &lo);
+    locate(shared->wrongRight, shared->wrongRightCount, from, &ri, &ro);
+
+    int *array = shared->array;
+    for (ptrdiff_t k = from; k < to; k++)
+    {
+        while (lo == shared->wrongLeft[li].length)
+        {
+            li++;
+            lo = 0;
+        }
+        while (ro == shared->wrongRight[ri].length)
+        {
+            ri++;
+            ro = 0;
+        }
+        ptrdiff_t a = shared->wrongLeft[li].start + lo++;
+        ptrdiff_t b = shared->wrongRight[ri].start + ro++;
+        int temp = array[a];
+        array[a] = array[b];
+        array[b] = temp;
+    }
+}
+
+// Sum the block counts and return the split index
+static ptrdiff_t run_block_pass(SortPool *pool, PartitionShared *shared)
+{
+    pool_parallel_for(pool, shared->parts, partition_own_block, shared);
+    ptrdiff_t split = shared->left;
+    for (int i = 0; i < shared->parts; i++)
+        split += shared->smallCount[i];
+    return split;
+}
+
+// One block pass plus the swap phase: array[left..split-1] small, the rest not
+static ptrdiff_t partition_pass(SortPool *pool, PartitionShared *shared)
+{
+    int parts = shared->parts;
+    ptrdiff_t split = run_block_pass(pool, shared);
+
+    // Every block is now [small | large]. Large elements before the split and
+    // small elements after it are misplaced, and there are equally many of each.
+    shared->wrongLeftCount = 0;
+    shared->wrongRightCount = 0;
+    shared->misplaced = 0;
+    for (int i = 0; i < parts; i++)
+    {
+        ptrdiff_t start = block_start(shared, i);
+        ptrdiff_t end = block_start(shared, i + 1);
+        ptrdiff_t middle = start + shared->smallCount[i];
+
+        // Large part [middle, end) overlapping [left, split)
+        ptrdiff_t from = middle;
+        ptrdiff_t to = end < split ? end : split;
+        if (from < to)
+        {
+            shared->wrongLeft[shared->wrongLeftCount++] = (Interval){from, to - from};
+            shared->misplaced += to - from;
+        }
+
+        // Small part [start, middle) overlapping [split, right]
+        from = start > split ? start : split;
+        to = middle;
+        if (from < to)
+            shared->wrongRight[shared->wrongRightCount++] = (Interval){from, to - from};
+    }
+
+    if (shared->misplaced > 0)
+        pool_parallel_for(pool, parts, swap_misplaced, shared);
+    return split;
+}
+
+static void shared_init(PartitionShared *shared, int *array, ptrdiff_t left, ptrdiff_t right, int pivot, int parts)
+{
+    if (parts < 1)
+        parts = 1;
+    if (parts > right - left + 1)
+        parts = (int)(right - left + 1);
+
+    shared->array = array;
+    shared->left = left;
+    shared->right = right;
+    shared->pivot = pivot;
+    shared->parts = parts;
+    shared->strict = 1;
+    shared->smallCount = (ptrdiff_t *)malloc(parts * sizeof(ptrdiff_t));
+    shared->wrongLeft = (Interval *)malloc(parts * sizeof(Interval));
+    shared->wrongRight = (Interval *)malloc(parts * sizeof(Interval));
+}
+
+static void shared_free(PartitionShared *shared)
+{
+    free(shared->smallCount);
+    free(shared->wrongLeft);
+    free(shared->wrongRight);
+}
+
+ptrdiff_t parallel_partition(SortPool *pool, int *array, ptrdiff_t left, ptrdiff_t right, int pivot, int parts)
+{
+    PartitionShared shared;
+    shared_init(&shared, array, left, right, pivot, parts);
+
+    ptrdiff_t split = partition_pass(pool, &shared);
+    if (split == left)
+    {
+        // Pivot is the minimum: split off everything equal to it instead
+        shared.strict = 0;
+        split = partition_pass(pool, &shared);
+    }
+
+    if (splitStatsEnabled)
+        record_split(right - left + 1, split - left);
+    shared_free(&shared);
+    return split;
+}
+
+void parallel_partition_three_way(SortPool *pool, int *array, ptrdiff_t left, ptrdiff_t right, int pivot, int parts,
+                                  ptrdiff_t *lessEnd, ptrdiff_t *greaterStart)
+{
+    PartitionShared shared;
+    shared_init(&shared, array, left, right, pivot, parts);
+
+    // First pass splits off the keys below the pivot ...
+    ptrdiff_t equalStart = partition_pass(pool, &shared);
+
+    // ... the second splits the rest into == pivot and > pivot
+    ptrdiff_t equalEnd = equalStart;
+    if (equalStart <= right)
+    {
+        shared.left = equalStart;
+        shared.strict = 0;
+        equalEnd = partition_pass(pool, &shared);
+    }
+
+    if (splitStatsEnabled)
+        record_split(right - left + 1, equalStart - left);
+    shared_free(&shared);
+    *lessEnd = equalStart - 1;
+    *greaterStart = equalEnd;
+}
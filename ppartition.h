@@ -0,0 +1,17 @@
+#ifndef PPARTITION_H
+#define PPARTITION_H
+
+#include "pool.h"
+
+// Cooperative partition of array[left..right] by `parts` pool workers.
+// Afterwards array[left..m-1] < pivot <= array[m..right]; returns m.
+// If no element is below the pivot, the split is taken at <= instead, so
+// both halves are non-empty unless every element equals the pivot.
+ptrdiff_t parallel_partition(SortPool *pool, int *array, ptrdiff_t left, ptrdiff_t right, int pivot, int parts);
+
+// Cooperative three-way partition: array[left..*lessEnd] < pivot,
+// array[*lessEnd+1..*greaterStart-1] == pivot, array[*greaterStart..right] > pivot
+void parallel_partition_three_way(SortPool *pool, int *array, ptrdiff_t left, ptrdiff_t right, int pivot, int parts,
+                                  ptrdiff_t *lessEnd, ptrdiff_t *greaterStart);
+
+#endif
@@ -0,0 +1,110 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "profile.h"
+#include "partition.h"
+
+#define PROFILE_PATH_MAX 512
+
+static SortProfile hostProfile;
+static int hostProfileLoaded = 0;
+static pthread_once_t hostProfileOnce = PTHREAD_ONCE_INIT;
+
+const char *profile_path(char *buffer, size_t length)
+{
+    const char *env = getenv("SORT_PROFILE");
+    if (env != NULL)
+    {
+        if (env[0] == '\0')
+            return NULL;
+        snprintf(buffer, length, "%s", env);
+        return buffer;
+    }
+
+    char host[256];
+    if (gethostname(host, sizeof(host)) != 0)
+        strcpy(host, "localhost");
+    host[sizeof(host) - 1] = '\0';
+    snprintf(buffer, length, "sort_profile.%s", host);
+    return buffer;
+}
+
+int profile_load(const char *path, SortProfile *profile)
+{
+    FILE *f = fopen(path, "r");
+    if (f == NULL)
+        return -1;
+
+    memset(profile, 0, sizeof(*profile));
+    char line[256];
+    int result = 0;
+    while (fgets(line, sizeof(line), f) != NULL)
+    {
+        char key[64];
+        int value;
+        char *comment = strchr(line, '#');
+        if (comment != NULL)
+            *comment = '\0';
+        int fields = sscanf(line, "%63s %d", key, &value);
+        if (fields <= 0)
+            continue; // Blank line
+        if (fields != 2 || value < 0)
+        {
+            result = -1;
+            break;
+        }
+        // Unknown keys are skipped so older engines can read newer profiles
+        if (strcmp(key, "pool_threshold") == 0)
+            profile->poolThreshold = value;
+        else if (strcmp(key, "small_threshold") == 0)
+            profile->smallThreshold = value;
+        else if (strcmp(key, "threads") == 0)
+            profile->threads = value;
+    }
+    fclose(f);
+    return result;
+}
+
+int profile_save(const char *path, const SortProfile *profile)
+{
+    FILE *f = fopen(path, "w");
+    if (f == NULL)
+        return -1;
+    char host[256];
+    if (gethostname(host, sizeof(host)) != 0)
+        strcpy(host, "localhost");
+    host[sizeof(host) - 1] = '\0';
+    fprintf(f, "# Sort profile for %s, written by bench --autotune\n", host);
+    fprintf(f, "pool_threshold %d\n", profile->poolThreshold);
+    fprintf(f, "small_threshold %d\n", profile->smallThreshold);
+    fprintf(f, "threads %d\n", profile->threads);
+    return fclose(f) == 0 ? 0 : -1;
+}
+
+static void load_host_profile(void)
+{
+    char buffer[PROFILE_PATH_MAX];
+    const char *path = profile_path(buffer, sizeof(buffer));
+    if (path == NULL)
+        return;
+    if (profile_load(path, &hostProfile) != 0)
+    {
+        if (access(path, F_OK) == 0)
+            fprintf(stderr, "sort: ignoring malformed profile %s\n", path);
+        return;
+    }
+    hostProfileLoaded = 1;
+    if (hostProfile.smallThreshold > 0)
+        smallThreshold = hostProfile.smallThreshold;
+}
+
+const SortProfile *host_profile(void)
+{
+    pthread_once(&hostProfileOnce, load_host_profile);
+    return hostProfileLoaded ? &hostProfile : NULL;
+}
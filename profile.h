@@ -0,0 +1,35 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stddef.h>
+
+// Per-host tuning profile written by `bench --autotune` and read by the sort
+// engines at startup. Plain "key value" lines; '#' starts a comment.
+//
+//   pool_threshold 65536
+//   small_threshold 32
+//   threads 8
+//
+// The file is sort_profile.<hostname> in the working directory, or whatever the
+// SORT_PROFILE environment variable names (empty disables loading).
+typedef struct
+{
+    int poolThreshold;  // Ranges below this are sorted by one worker (0 = built-in default)
+    int smallThreshold; // Leaf size of the sequential sort (0 = built-in default)
+    int threads;        // Pool workers when the caller asks for 0 (0 = one per core)
+} SortProfile;
+
+// Path of this host's profile; returns NULL if loading is disabled
+const char *profile_path(char *buffer, size_t length);
+
+// Read a profile; returns 0 on success, -1 if the file is missing or malformed
+int profile_load(const char *path, SortProfile *profile);
+
+// Write a profile; returns 0 on success, -1 on error
+int profile_save(const char *path, const SortProfile *profile);
+
+// This host's profile, loaded once on first use; NULL if there is none.
+// Loading also applies small_threshold to the sequential sort.
+const SortProfile *host_profile(void);
+
+#endif
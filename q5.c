@@ -3,7 +3,10 @@
 #include <pthread.h>
 #include <time.h>
 
+#include "network.h"
+
 #define THRESHOLD 5000000 // Threshold for switching to sequential quicksort
+#define BOUNDED_THREADS 1 // 1 = split a thread budget down the recursion, 0 = two new threads per partition
 
 #define MAX_THREADS 9    // Maximum number of threads to avoid oversubscription
 
@@ -16,6 +19,7 @@ typedef struct
     int *array;
     int left;
     int right;
+    int threads; // Thread budget for this range (bounded mode)
 } ThreadArgs;
 
 // Swap two elements
@@ -80,7 +84,16 @@ int partition_hoare(int *arr, int low, int high)
 // Partition the array: Median of Three partition
 int partition_median_of_three(int *arr, int low, int high)
 {
-    int pivot = arr[low + (high - low) / 2]; // Median of Three pivot
+    // Move the median of first, middle and last to arr[low] and use it as pivot
+    int mid = low + (high - low) / 2;
+    if (arr[mid] < arr[low])
+        swap(&arr[mid], &arr[low]);
+    if (arr[high] < arr[low])
+        swap(&arr[high], &arr[low]);
+    if (arr[high] < arr[mid])
+        swap(&arr[high], &arr[mid]);
+    swap(&arr[low], &arr[mid]);
+    int pivot = arr[low];
     int i = low - 1;
     int j = high + 1;
     while (1)
@@ -102,6 +115,10 @@ int partition_median_of_three(int *arr, int low, int high)
 // Sequential quicksort for small subarrays
 // Sequential quicksort for small subarrays
 void sequential_quicksort(int* array, int left, int right) {
+    if (right - left + 1 <= NETWORK_MAX) {
+        sort_network(array, left, right);
+        return;
+    }
     if (left < right) {
         int pivotIndex = partition_hoare(array, left, right);
         sequential_quicksort(array, left, pivotIndex);
@@ -127,8 +144,8 @@ void* parallel_quicksort(void* args) {
         int pivotIndex = partition_hoare(array, left, right);
 
         // Create thread arguments for left and right subarrays
-        ThreadArgs leftArgs = {array, left, pivotIndex};
-        ThreadArgs rightArgs = {array, pivotIndex + 1, right};
+        ThreadArgs leftArgs = {array, left, pivotIndex, 1};
+        ThreadArgs rightArgs = {array, pivotIndex + 1, right, 1};
 
         pthread_t leftThread, rightThread;
         int left_thread_created = 0;
@@ -183,11 +200,53 @@ void* parallel_quicksort(void* args) {
     return NULL;
 }
 
+// Parallel quicksort with a thread budget: each level sorts one half itself
+// and hands the other half, with its share of the budget, to one new thread
+void *parallel_quicksort_budget(void *args) {
+    ThreadArgs *budgetArgs = (ThreadArgs *)args;
+    int *array = budgetArgs->array;
+    int left = budgetArgs->left;
+    int right = budgetArgs->right;
+    int threads = budgetArgs->threads;
+
+    // Threads spawned here; the budget halves every level so 32 is plenty
+    pthread_t children[32];
+    ThreadArgs childArgs[32];
+    int childCount = 0;
+
+    while (threads > 1 && right - left >= THRESHOLD) {
+        int pivotIndex = partition_hoare(array, left, right);
+
+        // Give the right half and half of our budget away, keep the left half
+        int given = threads / 2;
+        childArgs[childCount] = (ThreadArgs){array, pivotIndex + 1, right, given};
+        if (pthread_create(&children[childCount], NULL, parallel_quicksort_budget, &childArgs[childCount]) == 0)
+            childCount++;
+        else
+            sequential_quicksort(array, pivotIndex + 1, right); // No thread to be had: sort that half here
+        right = pivotIndex;
+        threads -= given;
+    }
+
+    // Budget used up or range small enough: finish our share on this thread
+    sequential_quicksort(array, left, right);
+
+    for (int i = 0; i < childCount; i++) {
+        pthread_join(children[i], NULL);
+    }
+    return NULL;
+}
+
 // Function to initialize and start parallel quicksort
 void quicksort(int *array, int size)
 {
-    ThreadArgs args = {array, 0, size - 1};
+#if BOUNDED_THREADS
+    ThreadArgs args = {array, 0, size - 1, MAX_THREADS};
+    parallel_quicksort_budget(&args);
+#else
+    ThreadArgs args = {array, 0, size - 1, 1};
     parallel_quicksort(&args);
+#endif
 }
 
 // Function to generate a random array of integers
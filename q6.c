@@ -3,6 +3,8 @@
 #include <pthread.h>
 #include <unistd.h>
 
+#include "network.h"
+
 #define MAX_THREADS 8
 #define THRESHOLD 10000
 
@@ -95,6 +97,10 @@ void sequential_sort(int* array, int left, int right) {
     //     }
     //     array[j + 1] = key;
     // }
+    if (right - left + 1 <= NETWORK_MAX) {
+        sort_network(array, left, right);
+        return;
+    }
     if (left < right)
     {
 
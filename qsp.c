@@ -2,8 +2,12 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <time.h>
+#include <unistd.h>
+
+#include "network.h"
 
 #define PARALLEL_THRESHOLD 10000 // Threshold below which to switch to sequential sorting
+#define BOUNDED_THREADS 1 // 1 = split a thread budget down the recursion, 0 = two new threads per partition
 #define SMALL_THRESHOLD 50       // Threshold below which to use insertion sort
 
 // Structure to pass data to threads
@@ -11,6 +15,7 @@ typedef struct {
     int *arr;
     int left;
     int right;
+    int threads; // Thread budget for this range (bounded mode)
 } QuicksortArgs;
 
 // Function to perform insertion sort
@@ -46,6 +51,10 @@ int partition(int arr[], int left, int right) {
 
 // Sequential quicksort
 void sequential_quicksort(int arr[], int left, int right) {
+    if (right - left + 1 <= NETWORK_MAX) {
+        sort_network(arr, left, right);
+        return;
+    }
     if (left < right) {
         if (right - left < SMALL_THRESHOLD) {
             insertion_sort(arr, left, right);
@@ -71,8 +80,8 @@ void *parallel_quicksort(void *args) {
             int pivot = partition(arr, left, right);
 
             // Prepare arguments for the two recursive calls
-            QuicksortArgs leftArgs = {arr, left, pivot - 1};
-            QuicksortArgs rightArgs = {arr, pivot + 1, right};
+            QuicksortArgs leftArgs = {arr, left, pivot - 1, 1};
+            QuicksortArgs rightArgs = {arr, pivot + 1, right, 1};
 
             pthread_t leftThread, rightThread;
 
@@ -88,10 +97,52 @@ void *parallel_quicksort(void *args) {
     return NULL;
 }
 
+// Parallel quicksort with a thread budget: each level sorts one half itself
+// and hands the other half, with its share of the budget, to one new thread
+void *parallel_quicksort_budget(void *args) {
+    QuicksortArgs *budgetArgs = (QuicksortArgs *)args;
+    int *arr = budgetArgs->arr;
+    int left = budgetArgs->left;
+    int right = budgetArgs->right;
+    int threads = budgetArgs->threads;
+
+    // Threads spawned here; the budget halves every level so 32 is plenty
+    pthread_t children[32];
+    QuicksortArgs childArgs[32];
+    int childCount = 0;
+
+    while (threads > 1 && right - left >= PARALLEL_THRESHOLD) {
+        int pivotIndex = partition(arr, left, right);
+
+        // Give the right half and half of our budget away, keep the left half
+        int given = threads / 2;
+        childArgs[childCount] = (QuicksortArgs){arr, pivotIndex + 1, right, given};
+        if (pthread_create(&children[childCount], NULL, parallel_quicksort_budget, &childArgs[childCount]) == 0)
+            childCount++;
+        else
+            sequential_quicksort(arr, pivotIndex + 1, right); // No thread to be had: sort that half here
+        right = pivotIndex - 1;
+        threads -= given;
+    }
+
+    // Budget used up or range small enough: finish our share on this thread
+    sequential_quicksort(arr, left, right);
+
+    for (int i = 0; i < childCount; i++) {
+        pthread_join(children[i], NULL);
+    }
+    return NULL;
+}
+
 // Helper function to initiate parallel quicksort
 void quicksort(int arr[], int size) {
-    QuicksortArgs args = {arr, 0, size - 1};
+#if BOUNDED_THREADS
+    QuicksortArgs args = {arr, 0, size - 1, (int)sysconf(_SC_NPROCESSORS_ONLN)};
+    parallel_quicksort_budget(&args);
+#else
+    QuicksortArgs args = {arr, 0, size - 1, 1};
     parallel_quicksort(&args);
+#endif
 }
 
 // Function to generate a random array
@@ -3,6 +3,8 @@
 #include <pthread.h>
 #include <time.h>
 
+#include "network.h"
+
 // Structure to pass arguments to threads
 typedef struct
 {
@@ -76,6 +78,10 @@ void *quicksort(void *args)
 
 // Sequential quicksort for small subarrays
 void sequential_quicksort(int* array, int left, int right) {
+    if (right - left + 1 <= NETWORK_MAX) {
+        sort_network(array, left, right);
+        return;
+    }
     if (left < right) {
         int pivotIndex = partition(array, left, right);
         sequential_quicksort(array, left, pivotIndex - 1);
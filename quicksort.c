@@ -5,143 +5,55 @@
 #include <stdbool.h>
 #include <math.h>
 
-#define THRESHOLD 5000000 // Threshold for switching to sequential quicksort
-#define MAX_THREADS 14     // Maximum number of threads
-
-typedef struct
-{
-    int *array;
-    int left;
-    int right;
-} Task;
+#include "pool.h"
+#include "argsort.h"
+#include "select.h"
+#include "textio.h"
+#include "verify.h"
+#include "profile.h"
 
-// Task queue
-Task taskQueue[256];
-int taskCount = 0;
-bool shutdown = false;
+#define MAX_THREADS 14     // Maximum number of threads
 
-pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER; // Mutex for task queue
-pthread_cond_t cond = PTHREAD_COND_INITIALIZER;   // Condition variable for task queue
+SortPool *defaultPool = NULL; // Shared by every quicksort() call, created on first use
+pthread_once_t defaultPoolOnce = PTHREAD_ONCE_INIT;
 
-// Swap two elements
-void swap(int *a, int *b)
+void create_default_pool(void)
 {
-    int temp = *a;
-    *a = *b;
-    *b = temp;
-}
-
-// Partition the array: Hoare partition
-int partition_hoare(int *arr, int low, int high)
-{
-    int pivot = arr[low];
-    int i = low - 1, j = high + 1;
-
-    while (1)
+    const SortProfile *profile = host_profile();
+    defaultPool = pool_create(profile != NULL && profile->threads > 0 ? profile->threads : MAX_THREADS);
+    if (defaultPool == NULL)
     {
-        do
-        {
-            i++;
-        } while (arr[i] < pivot);
-
-        do
-        {
-            j--;
-        } while (arr[j] > pivot);
-
-        if (i >= j)
-            return j;
-
-        swap(&arr[i], &arr[j]);
+        fprintf(stderr, "quicksort: cannot start the thread pool\n");
+        exit(1);
     }
 }
 
-// Sequential quicksort for small subarrays
-void sequential_quicksort(int *array, int left, int right)
+// Function to start parallel quicksort on the shared, persistent thread pool
+void quicksort(int *array, ptrdiff_t size)
 {
-    if (left < right)
-    {
-        int pivotIndex = partition_hoare(array, left, right);
-        sequential_quicksort(array, left, pivotIndex);
-        sequential_quicksort(array, pivotIndex + 1, right);
-    }
+    pthread_once(&defaultPoolOnce, create_default_pool);
+    pool_sort(defaultPool, array, size);
 }
 
-// Worker function for the thread pool
-void *worker(void *arg)
+// Function to compute the sort order of keys on the shared pool, leaving the keys in place
+int argsort(const int *keys, ptrdiff_t size, ptrdiff_t *order)
 {
-    while (1)
-    {
-        pthread_mutex_lock(&mutex);
-        while (taskCount == 0 && !shutdown)
-        {
-            pthread_cond_wait(&cond, &mutex);
-        }
-        if (shutdown)
-        {
-            pthread_mutex_unlock(&mutex);
-            break;
-        }
-        // Get the next task from the queue
-        Task task = taskQueue[--taskCount];
-        pthread_mutex_unlock(&mutex);
-
-        // Perform the quicksort task
-        int *array = task.array;
-        int left = task.left;
-        int right = task.right;
-
-        if (right - left < THRESHOLD)
-        {
-            sequential_quicksort(array, left, right);
-        }
-        else
-        {
-            int pivotIndex = partition_hoare(array, left, right);
-            // Add left and right tasks to the queue
-            pthread_mutex_lock(&mutex);
-            taskQueue[taskCount++] = (Task){array, left, pivotIndex};
-            taskQueue[taskCount++] = (Task){array, pivotIndex + 1, right};
-            pthread_mutex_unlock(&mutex);
-            pthread_cond_signal(&cond);
-        }
-    }
-    return NULL;
+    pthread_once(&defaultPoolOnce, create_default_pool);
+    return pool_argsort(defaultPool, keys, size, order);
 }
 
-// Function to initialize and start parallel quicksort using a thread pool
-void quicksort(int *array, int size)
+// Function to put the nth smallest key at array[nth], smaller keys before it and larger after
+void parallel_select(int *array, ptrdiff_t size, ptrdiff_t nth)
 {
-    pthread_t threadPool[MAX_THREADS];
-
-    // Start the worker threads
-    for (int i = 0; i < MAX_THREADS; i++)
-    {
-        pthread_create(&threadPool[i], NULL, worker, NULL);
-    }
-
-    // Add the initial task to the queue
-    pthread_mutex_lock(&mutex);
-    taskQueue[taskCount++] = (Task){array, 0, size - 1};
-    pthread_mutex_unlock(&mutex);
-    pthread_cond_signal(&cond);
-
-    // Wait for the tasks to complete
-    pthread_mutex_lock(&mutex);
-    while (taskCount > 0)
-    {
-        pthread_mutex_unlock(&mutex);
-        pthread_mutex_lock(&mutex);
-    }
-    shutdown = true;
-    pthread_mutex_unlock(&mutex);
-    pthread_cond_broadcast(&cond);
+    pthread_once(&defaultPoolOnce, create_default_pool);
+    pool_select(defaultPool, array, size, nth);
+}
 
-    // Join the worker threads
-    for (int i = 0; i < MAX_THREADS; i++)
-    {
-        pthread_join(threadPool[i], NULL);
-    }
+// Function to sort only the k smallest keys into array[0..k-1]
+void parallel_partial_sort(int *array, ptrdiff_t size, ptrdiff_t k)
+{
+    pthread_once(&defaultPoolOnce, create_default_pool);
+    pool_partial_sort(defaultPool, array, size, k);
 }
 
 // Function to generate a random array of integers
@@ -153,40 +65,57 @@ void generate_random_array(int *array, int size)
     }
 }
 
+// Checked in parallel on the shared pool, if it has been created
 bool is_sorted(int *arr, int size) {
-    for (int i = 0; i < size; i++) {
-        if (arr[i] > arr[i + 1]) {
-            // print the two elements that are not in order
-            printf("arr[%d] = %d, arr[%d] = %d\n", i, arr[i], i + 1, arr[i + 1]);
-            return false;
-        }
+    ptrdiff_t i = find_unsorted(defaultPool, arr, size);
+    if (i >= 0) {
+        // print the two elements that are not in order
+        printf("arr[%td] = %d, arr[%td] = %d\n", i, arr[i], i + 1, arr[i + 1]);
+        return false;
     }
     return true;
 }
 
-// print the array
+// print the array, formatted in one buffer instead of one printf per key
 void print_array(int *arr, int size) {
-    for (int i = 0; i < size; i++) {
-        printf("%d ", arr[i]);
-    }
-    printf("\n");
+    size_t length;
+    char *text = format_ints(NULL, arr, size, ' ', &length);
+    if (text != NULL)
+        fwrite(text, 1, length, stdout);
+    free(text);
 }
 
 // Main function to test the parallel quicksort
 int main(void) {
     int n = 1 << 15;
+    int batches = 8;
     int *array = (int *)malloc(n * sizeof(int));
 
-    generate_random_array(array, n);
-    print_array(array, 10);
-    clock_t start_parallel = clock();
-    quicksort(array, n);
-    clock_t end_parallel = clock();
-    double time_parallel = (double)(end_parallel - start_parallel) / CLOCKS_PER_SEC;
-
-    printf("Parallel quicksort time for 2^%d: %f seconds\n", 15, time_parallel);
+    // The pool is created by the first call and reused by the rest
+    for (int b = 0; b < batches; b++) {
+        generate_random_array(array, n);
+        if (b == 0)
+            print_array(array, 10);
+        clock_t start_parallel = clock();
+        quicksort(array, n);
+        clock_t end_parallel = clock();
+        double time_parallel = (double)(end_parallel - start_parallel) / CLOCKS_PER_SEC;
+
+        printf("Parallel quicksort time for 2^%d (batch %d): %f seconds\n", 15, b, time_parallel);
+    }
     print_array(array, 10);
     is_sorted(array, n) ? printf("Array is sorted\n") : printf("Array is not sorted\n");
     free(array);
+
+    // Sort order of a column without reordering it
+    int column[] = {42, 7, 19, 7, 3};
+    ptrdiff_t order[5];
+    argsort(column, 5, order);
+    printf("argsort of 42 7 19 7 3:");
+    for (int i = 0; i < 5; i++)
+        printf(" %td", order[i]);
+    printf("\n");
+
+    pool_destroy(defaultPool);
     return 0;
 }
@@ -2,14 +2,20 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <time.h>
+#include <unistd.h>
+
+#include "network.h"
+#include "gen.h"
 
 #define ARRAY_SIZE (1 << 30) // Array size
+#define BOUNDED_THREADS 1 // 1 = split a thread budget down the recursion, 0 = two new threads per partition
 
 typedef struct {
     int *array;
     int left;
-    int threshold;
     int right;
+    int threshold;
+    int threads; // Thread budget for this range (bounded mode)
 } ThreadArgs;
 
 // Swap two elements
@@ -41,6 +47,11 @@ int partition(int *array, int left, int right)
 // Sequential quicksort for small subarrays
 void sequential_quicksort(int *array, int left, int right)
 {
+    if (right - left + 1 <= NETWORK_MAX)
+    {
+        sort_network(array, left, right);
+        return;
+    }
     if (left < right)
     {
         int pivotIndex = partition(array, left, right);
@@ -71,8 +82,8 @@ void *parallel_quicksort(void *args)
         int pivotIndex = partition(array, left, right);
 
         // Create thread arguments for left and right subarrays
-        ThreadArgs leftArgs = {array, left, pivotIndex - 1};
-        ThreadArgs rightArgs = {array, pivotIndex + 1, right};
+        ThreadArgs leftArgs = {array, left, pivotIndex - 1, threshold, 1};
+        ThreadArgs rightArgs = {array, pivotIndex + 1, right, threshold, 1};
 
         // Create threads for the left and right subarrays
         pthread_t leftThread, rightThread;
@@ -87,20 +98,57 @@ void *parallel_quicksort(void *args)
     return NULL;
 }
 
-// Function to initialize and start parallel quicksort
-void quicksort(int *array, int size)
+// Parallel quicksort with a thread budget: each level sorts one half itself
+// and hands the other half, with its share of the budget, to one new thread
+void *parallel_quicksort_budget(void *args)
 {
-    ThreadArgs args = {array, 0, size - 1};
-    parallel_quicksort(&args);
-}
+    ThreadArgs *budgetArgs = (ThreadArgs *)args;
+    int *array = budgetArgs->array;
+    int left = budgetArgs->left;
+    int right = budgetArgs->right;
+    int threshold = budgetArgs->threshold;
+    int threads = budgetArgs->threads;
+
+    // Threads spawned here; the budget halves every level so 32 is plenty
+    pthread_t children[32];
+    ThreadArgs childArgs[32];
+    int childCount = 0;
+
+    while (threads > 1 && right - left >= threshold)
+    {
+        int pivotIndex = partition(array, left, right);
 
-// Function to generate a random array of integers
-void generate_random_array(int *array, int size)
-{
-    for (int i = 0; i < size; i++)
+        // Give the right half and half of our budget away, keep the left half
+        int given = threads / 2;
+        childArgs[childCount] = (ThreadArgs){array, pivotIndex + 1, right, threshold, given};
+        if (pthread_create(&children[childCount], NULL, parallel_quicksort_budget, &childArgs[childCount]) == 0)
+            childCount++;
+        else
+            sequential_quicksort(array, pivotIndex + 1, right); // No thread to be had: sort that half here
+        right = pivotIndex - 1;
+        threads -= given;
+    }
+
+    // Budget used up or range small enough: finish our share on this thread
+    sequential_quicksort(array, left, right);
+
+    for (int i = 0; i < childCount; i++)
     {
-        array[i] = rand() % 100000;
+        pthread_join(children[i], NULL);
     }
+    return NULL;
+}
+
+// Function to initialize and start parallel quicksort
+void quicksort(int *array, int size, int threshold)
+{
+#if BOUNDED_THREADS
+    ThreadArgs args = {array, 0, size - 1, threshold, (int)sysconf(_SC_NPROCESSORS_ONLN)};
+    parallel_quicksort_budget(&args);
+#else
+    ThreadArgs args = {array, 0, size - 1, threshold, 1};
+    parallel_quicksort(&args);
+#endif
 }
 
 // Function to print the array (for debugging)
@@ -113,14 +161,27 @@ void print_array(int *array, int size)
     printf("\n");
 }
 
-// Main function to test the parallel quicksort with different thresholds
-int main()
+// Main function to test the parallel quicksort with different thresholds.
+// Optional argument: input distribution (see gen.h), uniform keys below 100000 by default.
+int main(int argc, char **argv)
 {
     int *array = (int *)malloc(ARRAY_SIZE * sizeof(int));
     int *array_copy = (int *)malloc(ARRAY_SIZE * sizeof(int));
 
-    // Generate a random array
-    generate_random_array(array, ARRAY_SIZE);
+    GenOptions gen;
+    gen_default_options(&gen);
+    gen.range = 100000;
+    if (argc > 1)
+    {
+        int dist = distribution_parse(argv[1]);
+        if (dist < 0)
+        {
+            fprintf(stderr, "unknown distribution '%s'\n", argv[1]);
+            return 1;
+        }
+        gen.dist = (Distribution)dist;
+    }
+    generate_input(array, ARRAY_SIZE, &gen);
 
     // Define different threshold values to test
     int thresholds[] = {100, 200, 300, 400, 500, 600, 700, 800, 900, 1000, 2000, 3000, 4000, 5000, 6000, 7000, 8000, 9000, 10000, 20000, 30000, 40000, 50000, 60000, 70000, 80000, 90000, 100000, 200000, 300000, 400000, 500000, 600000, 700000, 800000, 900000, 1000000, 2000000, 3000000, 4000000, 5000000, 6000000, 7000000, 8000000, 9000000, 10000000};
@@ -139,7 +200,7 @@ int main()
 
         // Measure time for parallel quicksort
         clock_t start_parallel = clock();
-        quicksort(array_copy, ARRAY_SIZE);
+        quicksort(array_copy, ARRAY_SIZE, threshold);
         clock_t end_parallel = clock();
         double time_parallel = (double)(end_parallel - start_parallel) / CLOCKS_PER_SEC;
 
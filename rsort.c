@@ -0,0 +1,326 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "rsort.h"
+#include "partition.h"
+
+#define RADIX_BITS 8
+#define RADIX_BUCKETS (1 << RADIX_BITS)
+#define RADIX_MIN (1 << 12)  // Smaller arrays are sorted by the caller alone
+#define RADIX_LEAF 64        // MSD ranges this small go to sequential_quicksort()
+#define WC_LINE 16           // Keys per write-combining buffer: one 64-byte line
+#define WC_LINE_BYTES (WC_LINE * (int)sizeof(int))
+
+typedef struct
+{
+    int *source;
+    int *target;
+    ptrdiff_t size;
+    int parts;
+    uint32_t base;    // Smallest key; digits are taken from key - base
+    int shift;        // Digit of this pass
+    ptrdiff_t *counts; // parts x RADIX_BUCKETS: histogram, then write offsets
+    int (*lines)[WC_LINE]; // parts x RADIX_BUCKETS write-combining lines, 64-byte aligned
+    int *partMin;     // Per part key range, from find_part_range()
+    int *partMax;
+} RadixShared;
+
+static ptrdiff_t part_start(RadixShared *shared, int part)
+{
+    return shared->size * part / shared->parts;
+}
+
+static inline unsigned digit_of(int key, uint32_t base, int shift)
+{
+    return (((uint32_t)key - base) >> shift) & (RADIX_BUCKETS - 1);
+}
+
+// MSD digit below the one at shift, or -1 after the last. The lowest digit may
+// overlap the one above it; those bits are already equal inside a bucket.
+static int lower_shift(int shift)
+{
+    if (shift == 0)
+        return -1;
+    return shift > RADIX_BITS ? shift - RADIX_BITS : 0;
+}
+
+static void find_part_range(void *arg, int part)
+{
+    RadixShared *shared = (RadixShared *)arg;
+    int low = INT_MAX, high = INT_MIN;
+    ptrdiff_t end = part_start(shared, part + 1);
+    for (ptrdiff_t i = part_start(shared, part); i < end; i++)
+    {
+        int key = shared->source[i];
+        low = key < low ? key : low;
+        high = key > high ? key : high;
+    }
+    shared->partMin[part] = low;
+    shared->partMax[part] = high;
+}
+
+// Number of low bits in which keys can differ once the minimum is subtracted
+static int significant_bits(SortPool *pool, RadixShared *shared)
+{
+    pool_parallel_for(pool, shared->parts, find_part_range, shared);
+    int low = INT_MAX, high = INT_MIN;
+    for (int p = 0; p < shared->parts; p++)
+    {
+        low = shared->partMin[p] < low ? shared->partMin[p] : low;
+        high = shared->partMax[p] > high ? shared->partMax[p] : high;
+    }
+    shared->base = (uint32_t)low;
+    uint32_t range = (uint32_t)high - (uint32_t)low;
+    int bits = 0;
+    while (bits < 32 && (range >> bits) != 0)
+        bits++;
+    return bits;
+}
+
+static void count_part(void *arg, int part)
+{
+    RadixShared *shared = (RadixShared *)arg;
+    ptrdiff_t *count = &shared->counts[(ptrdiff_t)part * RADIX_BUCKETS];
+    memset(count, 0, RADIX_BUCKETS * sizeof(ptrdiff_t));
+    ptrdiff_t end = part_start(shared, part + 1);
+    for (ptrdiff_t i = part_start(shared, part); i < end; i++)
+        count[digit_of(shared->source[i], shared->base, shared->shift)]++;
+}
+
+// Keys are staged per bucket and written a line at a time. A bucket's first
+// flush stops at the next 64-byte boundary of its output, so every later flush
+// stores one whole aligned line instead of straddling two.
+static void scatter_part(void *arg, int part)
+{
+    RadixShared *shared = (RadixShared *)arg;
+    ptrdiff_t *offset = &shared->counts[(ptrdiff_t)part * RADIX_BUCKETS];
+    int (*line)[WC_LINE] = &shared->lines[(ptrdiff_t)part * RADIX_BUCKETS];
+    int fill[RADIX_BUCKETS] = {0};
+    int limit[RADIX_BUCKETS]; // Keys that make up this bucket's next flush
+    int *target = shared->target;
+    ptrdiff_t end = part_start(shared, part + 1);
+
+    for (int d = 0; d < RADIX_BUCKETS; d++)
+        limit[d] = WC_LINE - (int)((uintptr_t)&target[offset[d]] % WC_LINE_BYTES / sizeof(int));
+
+    for (ptrdiff_t i = part_start(shared, part); i < end; i++)
+    {
+        int key = shared->source[i];
+        unsigned d = digit_of(key, shared->base, shared->shift);
+        line[d][fill[d]++] = key;
+        if (fill[d] == limit[d])
+        {
+            memcpy(&target[offset[d]], line[d], limit[d] * sizeof(int));
+            offset[d] += limit[d];
+            fill[d] = 0;
+            limit[d] = WC_LINE;
+        }
+    }
+    for (int d = 0; d < RADIX_BUCKETS; d++)
+    {
+        memcpy(&target[offset[d]], line[d], fill[d] * sizeof(int));
+        offset[d] += fill[d];
+    }
+}
+
+// Histogram, prefix sums and scatter of one digit from source to target.
+// Returns 0 without moving anything if every key has the same digit.
+static int distribute(SortPool *pool, RadixShared *shared, ptrdiff_t *bucketStart)
+{
+    int parts = shared->parts;
+    pool_parallel_for(pool, parts, count_part, shared);
+
+    ptrdiff_t offset = 0;
+    int used = 0;
+    for (int d = 0; d < RADIX_BUCKETS; d++)
+    {
+        if (bucketStart != NULL)
+            bucketStart[d] = offset;
+        ptrdiff_t total = 0;
+        for (int p = 0; p < parts; p++)
+        {
+            ptrdiff_t count = shared->counts[(ptrdiff_t)p * RADIX_BUCKETS + d];
+            shared->counts[(ptrdiff_t)p * RADIX_BUCKETS + d] = offset + total;
+            total += count;
+        }
+        used += total > 0;
+        offset += total;
+    }
+    if (bucketStart != NULL)
+        bucketStart[RADIX_BUCKETS] = offset;
+    if (used <= 1)
+        return 0;
+
+    pool_parallel_for(pool, parts, scatter_part, shared);
+    return 1;
+}
+
+static void copy_part(void *arg, int part)
+{
+    RadixShared *shared = (RadixShared *)arg;
+    ptrdiff_t start = part_start(shared, part);
+    ptrdiff_t end = part_start(shared, part + 1);
+    memcpy(shared->target + start, shared->source + start, (size_t)(end - start) * sizeof(int));
+}
+
+static int shared_init(RadixShared *shared, SortPool *pool, int *array, ptrdiff_t size)
+{
+    shared->parts = pool_size(pool);
+    shared->size = size;
+    shared->source = array;
+    shared->target = (int *)malloc((size_t)size * sizeof(int));
+    shared->counts = (ptrdiff_t *)malloc((size_t)shared->parts * RADIX_BUCKETS * sizeof(ptrdiff_t));
+    shared->partMin = (int *)malloc(shared->parts * sizeof(int));
+    shared->partMax = (int *)malloc(shared->parts * sizeof(int));
+    shared->lines = aligned_alloc(WC_LINE_BYTES, (size_t)shared->parts * RADIX_BUCKETS * WC_LINE_BYTES);
+    return shared->target != NULL && shared->counts != NULL && shared->partMin != NULL && shared->partMax != NULL &&
+           shared->lines != NULL;
+}
+
+static void shared_free(RadixShared *shared, int *array)
+{
+    free(shared->source == array ? shared->target : shared->source);
+    free(shared->counts);
+    free(shared->partMin);
+    free(shared->partMax);
+    free(shared->lines);
+}
+
+void pool_radix_sort(SortPool *pool, int *array, ptrdiff_t size)
+{
+    if (size < RADIX_MIN)
+    {
+        if (size > 1)
+            sequential_quicksort(array, 0, size - 1);
+        return;
+    }
+
+    RadixShared shared;
+    if (!shared_init(&shared, pool, array, size))
+    {
+        shared_free(&shared, array);
+        pool_sort(pool, array, size);
+        return;
+    }
+
+    int bits = significant_bits(pool, &shared);
+    for (shared.shift = 0; shared.shift < bits; shared.shift += RADIX_BITS)
+    {
+        if (distribute(pool, &shared, NULL))
+        {
+            int *swap = shared.source;
+            shared.source = shared.target;
+            shared.target = swap;
+        }
+    }
+
+    // An odd number of moves leaves the result in the buffer
+    if (shared.source != array)
+    {
+        shared.target = array;
+        pool_parallel_for(pool, shared.parts, copy_part, &shared);
+    }
+    shared_free(&shared, array);
+}
+
+// In-place MSD radix sort (American flag sort) of array[0..size-1] on the digit
+// at shift and every lower one
+static void american_flag_sort(int *array, ptrdiff_t size, uint32_t base, int shift)
+{
+    if (size <= RADIX_LEAF || shift < 0)
+    {
+        if (size > 1 && shift >= 0)
+            sequential_quicksort(array, 0, size - 1);
+        return;
+    }
+
+    ptrdiff_t count[RADIX_BUCKETS] = {0};
+    for (ptrdiff_t i = 0; i < size; i++)
+        count[digit_of(array[i], base, shift)]++;
+
+    ptrdiff_t start[RADIX_BUCKETS + 1], next[RADIX_BUCKETS];
+    start[0] = 0;
+    for (int d = 0; d < RADIX_BUCKETS; d++)
+    {
+        start[d + 1] = start[d] + count[d];
+        next[d] = start[d];
+    }
+
+    // Cycle each misplaced key to its bucket's next free slot
+    for (int d = 0; d < RADIX_BUCKETS; d++)
+    {
+        while (next[d] < start[d + 1])
+        {
+            int key = array[next[d]];
+            unsigned k = digit_of(key, base, shift);
+            while (k != (unsigned)d)
+            {
+                int displaced = array[next[k]];
+                array[next[k]++] = key;
+                key = displaced;
+                k = digit_of(key, base, shift);
+            }
+            array[next[d]++] = key;
+        }
+    }
+
+    for (int d = 0; d < RADIX_BUCKETS; d++)
+        american_flag_sort(array + start[d], count[d], base, lower_shift(shift));
+}
+
+typedef struct
+{
+    int *array;
+    ptrdiff_t *bucketStart;
+    uint32_t base;
+    int shift;
+} MsdShared;
+
+static void sort_top_bucket(void *arg, int bucket)
+{
+    MsdShared *msd = (MsdShared *)arg;
+    ptrdiff_t start = msd->bucketStart[bucket];
+    ptrdiff_t end = msd->bucketStart[bucket + 1];
+    american_flag_sort(msd->array + start, end - start, msd->base, msd->shift);
+}
+
+void pool_radix_sort_msd(SortPool *pool, int *array, ptrdiff_t size)
+{
+    if (size < RADIX_MIN)
+    {
+        if (size > 1)
+            sequential_quicksort(array, 0, size - 1);
+        return;
+    }
+
+    RadixShared shared;
+    if (!shared_init(&shared, pool, array, size))
+    {
+        shared_free(&shared, array);
+        pool_sort(pool, array, size);
+        return;
+    }
+
+    // The top digit is the highest RADIX_BITS of the significant bits
+    int bits = significant_bits(pool, &shared);
+    if (bits > 0)
+    {
+        shared.shift = bits > RADIX_BITS ? bits - RADIX_BITS : 0;
+        ptrdiff_t bucketStart[RADIX_BUCKETS + 1];
+        if (distribute(pool, &shared, bucketStart))
+        {
+            int *buffer = shared.target;
+            shared.source = buffer;
+            shared.target = array;
+            pool_parallel_for(pool, shared.parts, copy_part, &shared);
+            shared.source = array;
+            shared.target = buffer;
+        }
+
+        MsdShared msd = {array, bucketStart, shared.base, lower_shift(shared.shift)};
+        pool_parallel_for(pool, RADIX_BUCKETS, sort_top_bucket, &msd);
+    }
+    shared_free(&shared, array);
+}
@@ -0,0 +1,21 @@
+#ifndef RSORT_H
+#define RSORT_H
+
+#include "pool.h"
+
+// Parallel radix sorts for int keys. Both first find the key range and only
+// look at the bits in which keys differ, so rand() % 100 input takes one
+// digit instead of four. Both need a temporary copy of the array.
+
+// LSD: one stable counting pass per 8-bit digit, lowest digit first. Each worker
+// builds a histogram of its share and scatters it through write-combining
+// buffers that fill a cache line per bucket before it goes to memory.
+void pool_radix_sort(SortPool *pool, int *array, ptrdiff_t size);
+
+// MSD: the top digit is distributed in parallel like an LSD pass. Each of its
+// buckets is then finished by one worker with in-place American flag sort,
+// recursing digit by digit until ranges are small enough for the
+// sequential quicksort.
+void pool_radix_sort_msd(SortPool *pool, int *array, ptrdiff_t size);
+
+#endif
@@ -1,4 +1,4 @@
 #!/bin/bash
 
-gcc -o quicksort -std=c99 -pthread quicksort.c -pg
+gcc -o quicksort -std=c11 -pthread quicksort.c pool.c numa.c partition.c ppartition.c vpartition.c profile.c argsort.c ssort.c gsort.c select.c textio.c verify.c -pg
 ./quicksort
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "select.h"
+#include "partition.h"
+#include "ppartition.h"
+
+#define SELECT_PARALLEL_MIN (1 << 18) // Smallest range partitioned by the whole pool
+#define SELECT_SAMPLE 256             // Keys sampled for the pivot of a parallel round
+#define SELECT_MARGIN 8               // Sample ranks between the target and the pivot
+
+// Pivot for a parallel round: the sampled key a few ranks past the target,
+// toward the middle. The side holding the target is then only a little larger
+// than the target's distance from the end, instead of half the range.
+static int select_pivot(const int *array, ptrdiff_t left, ptrdiff_t right, ptrdiff_t nth)
+{
+    int sample[SELECT_SAMPLE];
+    ptrdiff_t size = right - left + 1;
+    for (int i = 0; i < SELECT_SAMPLE; i++)
+        sample[i] = array[left + size * (2 * i + 1) / (2 * SELECT_SAMPLE)];
+    insertion_sort(sample, 0, SELECT_SAMPLE - 1);
+
+    int target = (int)((nth - left) * SELECT_SAMPLE / size);
+    if (target < SELECT_SAMPLE / 2)
+        target = target + SELECT_MARGIN < SELECT_SAMPLE / 2 ? target + SELECT_MARGIN : SELECT_SAMPLE / 2;
+    else
+        target = target - SELECT_MARGIN > SELECT_SAMPLE / 2 ? target - SELECT_MARGIN : SELECT_SAMPLE / 2;
+    return sample[target];
+}
+
+void pool_select(SortPool *pool, int *array, ptrdiff_t size, ptrdiff_t nth)
+{
+    if (nth < 0 || nth >= size)
+        return;
+
+    ptrdiff_t left = 0, right = size - 1;
+    int depthLimit = introsort_depth_limit(size);
+    int parts = pool_size(pool);
+
+    // The keys equal to the pivot land between the two sides, so every round
+    // drops at least one key even when the pivot is the minimum. A one-worker
+    // pool still gets the rounds for their sampled pivot.
+    while (right - left + 1 >= SELECT_PARALLEL_MIN && depthLimit > 0)
+    {
+        depthLimit--;
+        ptrdiff_t lessEnd, greaterStart;
+        int pivot = select_pivot(array, left, right, nth);
+        parallel_partition_three_way(pool, array, left, right, pivot, parts, &lessEnd, &greaterStart);
+        if (nth <= lessEnd)
+            right = lessEnd;
+        else if (nth >= greaterStart)
+            left = greaterStart;
+        else
+            return;
+    }
+
+    while (right - left >= smallThreshold && depthLimit > 0)
+    {
+        depthLimit--;
+        ptrdiff_t leftEnd, rightStart;
+        partition_range(array, left, right, &leftEnd, &rightStart);
+        if (nth <= leftEnd)
+            right = leftEnd;
+        else if (nth >= rightStart)
+            left = rightStart;
+        else
+            return;
+    }
+
+    // Small enough, or the pivots went bad: sorting what is left is bounded
+    introsort(array, left, right, depthLimit);
+}
+
+void pool_partial_sort(SortPool *pool, int *array, ptrdiff_t size, ptrdiff_t k)
+{
+    if (k <= 0)
+        return;
+    if (k >= size)
+    {
+        pool_sort(pool, array, size);
+        return;
+    }
+    // array[k-1] is final after the selection, only the keys before it need sorting
+    pool_select(pool, array, size, k - 1);
+    pool_sort(pool, array, k - 1);
+}
@@ -0,0 +1,22 @@
+#ifndef SELECT_H
+#define SELECT_H
+
+#include <stddef.h>
+
+#include "pool.h"
+
+// Quickselect on the partition kernels: every round partitions the range and
+// keeps only the side holding the target rank. Large ranges are partitioned
+// by all of the pool's workers around a pivot sampled near the target rank, so
+// a small k throws away most of the array in the first round; the rest runs in
+// the caller with the selected sequential kernel.
+
+// nth_element: afterwards array[nth] holds the key it would hold if the array
+// were sorted, no key before it is greater and no key after it is smaller
+void pool_select(SortPool *pool, int *array, ptrdiff_t size, ptrdiff_t nth);
+
+// Top-k: afterwards array[0..k-1] holds the k smallest keys in sorted order;
+// the order of the rest is unspecified
+void pool_partial_sort(SortPool *pool, int *array, ptrdiff_t size, ptrdiff_t k);
+
+#endif
@@ -0,0 +1,542 @@
+#define _DEFAULT_SOURCE // MAP_POPULATE and madvise()
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <time.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "pool.h"
+#include "partition.h"
+#include "msort.h"
+#include "ssort.h"
+#include "rsort.h"
+#include "extsort.h"
+#include "gsort.h"
+#include "textio.h"
+
+// Sort files of raw little-endian int32 or int64 keys, or of decimal int text:
+//
+//   ./sortfile --memory 4G --temp-dir /scratch keys.bin keys.sorted
+//   ./sortfile --in-place keys.bin
+//   producer | ./sortfile - - | consumer
+//   ./sortfile --text --delimiter , keys.csv keys.sorted.csv
+//
+// INPUT OUTPUT runs the external sort for int32 keys: runs are sorted with the
+// chosen engine, spilled to the temp dir and merged into the output. Two runs
+// and the engine's scratch fit --memory, so a run is half of it under pool, a
+// third under merge and radix, and 2/7 under sample. Either may be - for stdin/stdout. --in-place maps the file and
+// sorts it where it lies, so the keys are never copied; an OUTPUT that is the
+// INPUT file does the same, and is refused for text. int64 keys are sorted
+// in memory. --text reads ints written in decimal, separated by commas or
+// whitespace, and writes them back one per line or with --delimiter; it
+// sorts in memory too. Throughput goes to stderr.
+
+#ifdef MAP_POPULATE
+#define MAP_PREFAULT MAP_POPULATE // Read the file in up front rather than one page fault at a time
+#else
+#define MAP_PREFAULT 0
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#error "sortfile reads little-endian keys as they are in memory"
+#endif
+
+typedef struct
+{
+    const char *name;
+    void (*sort)(SortPool *pool, int *array, ptrdiff_t size);
+    size_t scratchPerKey; // Out-of-place buffers the engine allocates, per key
+} RunEngine;
+
+static const RunEngine runEngines[] = {
+    {"pool", pool_sort, 0},
+    {"merge", pool_merge_sort, sizeof(int)},
+    {"sample", pool_sample_sort, sizeof(int) + sizeof(uint16_t)}, // Buffer and bucket ids
+    {"radix", pool_radix_sort, sizeof(int)},
+    {"radix_msd", pool_radix_sort_msd, sizeof(int)},
+};
+#define RUN_ENGINE_COUNT (int)(sizeof(runEngines) / sizeof(runEngines[0]))
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(FILE *out)
+{
+    fprintf(out,
+            "usage: sortfile [options] INPUT OUTPUT   (- for stdin / stdout)\n"
+            "       sortfile [options] --in-place FILE\n"
+            "  --in-place         map FILE and sort it in place\n"
+            "  --type NAME        key type: int32 (default), int64\n"
+            "  --text             decimal int text in and out, sorted in memory\n"
+            "  --delimiter C      text output separator: , space tab or newline (default)\n"
+            "  --memory SIZE      memory budget for keys, e.g. 512M, 4G (default 1G)\n"
+            "  --temp-dir DIR     where runs are spilled (default $TMPDIR, else /tmp)\n"
+            "  --engine NAME      run sort: pool (default), merge, sample, radix, radix_msd\n"
+            "  --kernel NAME      partition kernel of the pool engine (default hoare)\n"
+            "  --threads N        pool workers, 0 = one per core (default)\n");
+}
+
+// Parse a plain number in [min, max]
+static long parse_count(const char *text, long min, long max)
+{
+    char *end;
+    long value = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || value < min || value > max)
+    {
+        fprintf(stderr, "sortfile: bad count '%s'\n", text);
+        exit(2);
+    }
+    return value;
+}
+
+// Parse a byte count with an optional K, M or G suffix (powers of 1024)
+static size_t parse_bytes(const char *text)
+{
+    char *end;
+    unsigned long long value = strtoull(text, &end, 10);
+    int shift = 0;
+    if (*end == 'K' || *end == 'k')
+        shift = 10;
+    else if (*end == 'M' || *end == 'm')
+        shift = 20;
+    else if (*end == 'G' || *end == 'g')
+        shift = 30;
+    if (shift > 0)
+        end++;
+    // strtoull() takes a sign and wraps a negative value around
+    if (text[0] < '0' || text[0] > '9' || *end != '\0' || value == 0 || value > (~0ULL >> shift))
+    {
+        fprintf(stderr, "sortfile: bad size '%s'\n", text);
+        exit(2);
+    }
+    return (size_t)(value << shift);
+}
+
+// Map the file and sort it where it lies: no read, no write, no copy
+static int sort_in_place(SortPool *pool, const char *path, int wide, void (*sortRun)(SortPool *, int *, ptrdiff_t))
+{
+    size_t keySize = wide ? sizeof(int64_t) : sizeof(int);
+    int fd = open(path, O_RDWR);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0)
+    {
+        fprintf(stderr, "sortfile: %s: %s\n", path, strerror(errno));
+        if (fd >= 0)
+            close(fd);
+        return -1;
+    }
+    size_t bytes = (size_t)st.st_size;
+    if (bytes % keySize != 0)
+    {
+        fprintf(stderr, "sortfile: %s is not a whole number of %zu-byte keys\n", path, keySize);
+        close(fd);
+        return -1;
+    }
+    if (bytes == 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    double start = now();
+    void *data = mmap(NULL, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_PREFAULT, fd, 0);
+    if (data == MAP_FAILED)
+    {
+        fprintf(stderr, "sortfile: %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    // Hints only: failures are harmless
+    madvise(data, bytes, MADV_WILLNEED);
+#ifdef MADV_HUGEPAGE
+    madvise(data, bytes, MADV_HUGEPAGE);
+#endif
+    double mapped = now();
+
+    ptrdiff_t keys = (ptrdiff_t)(bytes / keySize);
+    if (wide)
+        gsort_int64(pool, (int64_t *)data, keys);
+    else
+        sortRun(pool, (int *)data, keys);
+    double sorted = now();
+
+    // The dirty pages go back to the file; msync() makes it durable before exit
+    int status = msync(data, bytes, MS_SYNC);
+    if (status < 0)
+        fprintf(stderr, "sortfile: %s: %s\n", path, strerror(errno));
+    munmap(data, bytes);
+    close(fd);
+    double end = now();
+
+    double megabytes = bytes / 1e6;
+    fprintf(stderr, "sortfile: %td keys in place: map %.3f s, sort %.3f s (%.1f MB/s), sync %.3f s, total %.1f MB/s\n",
+            keys, mapped - start, sorted - mapped, megabytes / (sorted - mapped), end - sorted,
+            megabytes / (end - start));
+    return status;
+}
+
+// Read until count bytes or end of file; returns the bytes read, or -1
+static ssize_t read_full(int fd, void *buffer, size_t count)
+{
+    size_t done = 0;
+    while (done < count)
+    {
+        ssize_t n = read(fd, (char *)buffer + done, count - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return -1;
+        if (n == 0)
+            break;
+        done += (size_t)n;
+    }
+    return (ssize_t)done;
+}
+
+static int write_full(int fd, const void *buffer, size_t count)
+{
+    size_t done = 0;
+    while (done < count)
+    {
+        ssize_t n = write(fd, (const char *)buffer + done, count - done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return -1;
+        done += (size_t)n;
+    }
+    return 0;
+}
+
+// Read all of fd into a malloc()ed buffer. A regular file is read into a
+// buffer one byte longer than the file, so end of file shows without a
+// realloc(); a pipe into one that doubles as it fills.
+static char *read_all(int fd, size_t *length)
+{
+    struct stat st;
+    size_t capacity = 1 << 20;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+        capacity = (size_t)st.st_size + 1;
+    char *buffer = (char *)malloc(capacity);
+    size_t bytes = 0;
+    while (buffer != NULL)
+    {
+        if (bytes == capacity)
+        {
+            char *grown = (char *)realloc(buffer, 2 * capacity);
+            if (grown == NULL)
+                break;
+            buffer = grown;
+            capacity *= 2;
+        }
+        ssize_t got = read_full(fd, buffer + bytes, capacity - bytes);
+        if (got < 0)
+        {
+            fprintf(stderr, "sortfile: read: %s\n", strerror(errno));
+            free(buffer);
+            return NULL;
+        }
+        bytes += (size_t)got;
+        if (bytes < capacity)
+            break; // End of input
+    }
+    if (buffer == NULL || bytes == capacity)
+    {
+        fprintf(stderr, "sortfile: input does not fit in memory\n");
+        free(buffer);
+        return NULL;
+    }
+    *length = bytes;
+    return buffer;
+}
+
+// int64 keys from a file or a pipe, sorted in memory
+static int sort_int64_stream(SortPool *pool, int inputFd, int outputFd)
+{
+    double start = now();
+    size_t bytes;
+    char *buffer = read_all(inputFd, &bytes);
+    if (buffer == NULL)
+        return -1;
+    if (bytes % sizeof(int64_t) != 0)
+    {
+        fprintf(stderr, "sortfile: input is not a whole number of int64 keys\n");
+        free(buffer);
+        return -1;
+    }
+    double loaded = now();
+
+    ptrdiff_t keys = (ptrdiff_t)(bytes / sizeof(int64_t));
+    gsort_int64(pool, (int64_t *)buffer, keys);
+    double sorted = now();
+
+    int status = write_full(outputFd, buffer, bytes);
+    if (status < 0)
+        fprintf(stderr, "sortfile: write: %s\n", strerror(errno));
+    free(buffer);
+    double end = now();
+
+    double megabytes = bytes / 1e6;
+    fprintf(stderr, "sortfile: %td int64 keys: read %.3f s, sort %.3f s, write %.3f s, total %.1f MB/s\n", keys,
+            loaded - start, sorted - loaded, end - sorted, end > start ? megabytes / (end - start) : 0);
+    return status;
+}
+
+// Decimal text in and out. A regular file is mapped rather than read; the
+// parse, the sort and the format all run on the pool.
+static int sort_text(SortPool *pool, int inputFd, int outputFd, char delimiter,
+                     void (*sortRun)(SortPool *, int *, ptrdiff_t))
+{
+    double start = now();
+    struct stat st;
+    size_t bytes = 0;
+    void *mapped = MAP_FAILED;
+    char *buffer = NULL;
+    if (fstat(inputFd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        bytes = (size_t)st.st_size;
+        mapped = mmap(NULL, bytes, PROT_READ, MAP_PRIVATE | MAP_PREFAULT, inputFd, 0);
+    }
+    if (mapped == MAP_FAILED && (buffer = read_all(inputFd, &bytes)) == NULL)
+        return -1;
+    double loaded = now();
+
+    int *keys;
+    ptrdiff_t count = parse_ints(pool, mapped != MAP_FAILED ? (const char *)mapped : buffer, bytes, &keys);
+    if (mapped != MAP_FAILED)
+        munmap(mapped, bytes);
+    free(buffer);
+    if (count < 0)
+    {
+        fprintf(stderr, "sortfile: %s\n",
+                errno == EINVAL   ? "input is not delimited decimal ints"
+                : errno == ERANGE ? "input has a key outside int"
+                                  : strerror(errno));
+        return -1;
+    }
+    double parsed = now();
+
+    sortRun(pool, keys, count);
+    double sorted = now();
+
+    size_t length;
+    char *text = format_ints(pool, keys, count, delimiter, &length);
+    free(keys);
+    if (text == NULL)
+    {
+        fprintf(stderr, "sortfile: output does not fit in memory\n");
+        return -1;
+    }
+    double formatted = now();
+
+    int status = write_full(outputFd, text, length);
+    if (status < 0)
+        fprintf(stderr, "sortfile: write: %s\n", strerror(errno));
+    free(text);
+    double end = now();
+
+    fprintf(stderr,
+            "sortfile: %td keys as text: read %.3f s, parse %.3f s (%.1f MB/s), sort %.3f s, format %.3f s (%.1f MB/s), "
+            "write %.3f s\n",
+            count, loaded - start, parsed - loaded, parsed > loaded ? bytes / 1e6 / (parsed - loaded) : 0,
+            sorted - parsed, formatted - sorted, formatted > sorted ? length / 1e6 / (formatted - sorted) : 0,
+            end - formatted);
+    return status;
+}
+
+static int sort_external(SortPool *pool, int inputFd, int outputFd, const ExtSortOptions *options)
+{
+    ExtSortStats stats;
+    if (external_sort(pool, inputFd, outputFd, options, &stats) < 0)
+    {
+        fprintf(stderr, "sortfile: %s\n", errno == EINVAL ? "input is not a whole number of int keys" : strerror(errno));
+        return -1;
+    }
+
+    double seconds = stats.runSeconds + stats.mergeSeconds;
+    double megabytes = stats.bytes / 1e6;
+    fprintf(stderr, "sortfile: %lld keys, %d runs, %d merge passes\n", stats.bytes / (long long)sizeof(int),
+            stats.runs, stats.mergePasses);
+    fprintf(stderr, "sortfile: runs %.3f s (%.1f MB/s), merge %.3f s (%.1f MB/s), total %.1f MB/s\n",
+            stats.runSeconds, stats.runSeconds > 0 ? megabytes / stats.runSeconds : 0, stats.mergeSeconds,
+            stats.mergeSeconds > 0 ? megabytes / stats.mergeSeconds : 0, seconds > 0 ? megabytes / seconds : 0);
+    return 0;
+}
+
+// Whether the output names the file the input was opened on. Opening it with
+// O_TRUNC would empty the input before a single key is read.
+static int same_file(int inputFd, const char *outputPath)
+{
+    struct stat input, output;
+    if (fstat(inputFd, &input) < 0)
+        return 0;
+    int found = strcmp(outputPath, "-") == 0 ? fstat(STDOUT_FILENO, &output) : stat(outputPath, &output);
+    return found == 0 && input.st_dev == output.st_dev && input.st_ino == output.st_ino;
+}
+
+int main(int argc, char **argv)
+{
+    static const struct option longOptions[] = {
+        {"in-place", no_argument, NULL, 'i'},
+        {"type", required_argument, NULL, 't'},
+        {"text", no_argument, NULL, 'x'},
+        {"delimiter", required_argument, NULL, 'd'},
+        {"memory", required_argument, NULL, 'm'},
+        {"temp-dir", required_argument, NULL, 'T'},
+        {"engine", required_argument, NULL, 'e'},
+        {"kernel", required_argument, NULL, 'k'},
+        {"threads", required_argument, NULL, 'j'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+
+    ExtSortOptions options;
+    extsort_default_options(&options);
+    int inPlace = 0;
+    int wide = 0;
+    int text = 0;
+    char delimiter = '\n';
+    int threads = 0;
+    int c, found;
+    while ((c = getopt_long(argc, argv, "", longOptions, NULL)) != -1)
+    {
+        switch (c)
+        {
+        case 'i':
+            inPlace = 1;
+            break;
+        case 't':
+            if (strcmp(optarg, "int32") != 0 && strcmp(optarg, "int64") != 0)
+            {
+                fprintf(stderr, "sortfile: unknown type '%s'\n", optarg);
+                return 2;
+            }
+            wide = strcmp(optarg, "int64") == 0;
+            break;
+        case 'x':
+            text = 1;
+            break;
+        case 'd':
+            if (strlen(optarg) != 1 || strchr(",\n\r\t ", optarg[0]) == NULL)
+            {
+                fprintf(stderr, "sortfile: the delimiter must be one of , space tab or newline\n");
+                return 2;
+            }
+            delimiter = optarg[0];
+            break;
+        case 'm':
+            options.memoryBytes = parse_bytes(optarg);
+            break;
+        case 'T':
+            options.tempDir = optarg;
+            break;
+        case 'e':
+            found = -1;
+            for (int i = 0; i < RUN_ENGINE_COUNT; i++)
+            {
+                if (strcmp(optarg, runEngines[i].name) == 0)
+                    found = i;
+            }
+            if (found < 0)
+            {
+                fprintf(stderr, "sortfile: unknown engine '%s'\n", optarg);
+                return 2;
+            }
+            options.sortRun = runEngines[found].sort;
+            options.scratchPerKey = runEngines[found].scratchPerKey;
+            break;
+        case 'k':
+            found = partition_kernel_parse(optarg);
+            if (found < 0)
+            {
+                fprintf(stderr, "sortfile: unknown kernel '%s'\n", optarg);
+                return 2;
+            }
+            partitionKernel = (PartitionKernel)found;
+            break;
+        case 'j':
+            threads = (int)parse_count(optarg, 0, INT_MAX);
+            break;
+        case 'h':
+            usage(stdout);
+            return 0;
+        default:
+            usage(stderr);
+            return 2;
+        }
+    }
+    if (argc - optind != (inPlace ? 1 : 2) || (text && (inPlace || wide)))
+    {
+        usage(stderr);
+        return 2;
+    }
+
+    SortPool *pool = pool_create(threads);
+    if (pool == NULL)
+    {
+        fprintf(stderr, "sortfile: cannot start the thread pool\n");
+        return 1;
+    }
+    int status;
+    if (inPlace)
+    {
+        status = sort_in_place(pool, argv[optind], wide, options.sortRun);
+    }
+    else
+    {
+        const char *inputPath = argv[optind];
+        const char *outputPath = argv[optind + 1];
+        int inputFd = strcmp(inputPath, "-") == 0 ? STDIN_FILENO : open(inputPath, O_RDONLY);
+        int outputFd = -1;
+        status = -1;
+        if (inputFd < 0)
+        {
+            fprintf(stderr, "sortfile: %s: %s\n", inputPath, strerror(errno));
+        }
+        else if (same_file(inputFd, outputPath))
+        {
+            // Raw keys of a named file can be sorted where they lie; text cannot
+            if (!text && inputFd != STDIN_FILENO)
+                status = sort_in_place(pool, inputPath, wide, options.sortRun);
+            else
+                fprintf(stderr, "sortfile: %s is also the input; give another output\n", outputPath);
+        }
+        else
+        {
+            outputFd = strcmp(outputPath, "-") == 0 ? STDOUT_FILENO
+                                                    : open(outputPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            if (outputFd < 0)
+                fprintf(stderr, "sortfile: %s: %s\n", outputPath, strerror(errno));
+        }
+
+        if (inputFd >= 0 && outputFd >= 0)
+        {
+            if (text)
+                status = sort_text(pool, inputFd, outputFd, delimiter, options.sortRun);
+            else if (wide)
+                status = sort_int64_stream(pool, inputFd, outputFd);
+            else
+                status = sort_external(pool, inputFd, outputFd, &options);
+        }
+        if (inputFd > STDIN_FILENO)
+            close(inputFd);
+        if (outputFd > STDOUT_FILENO && close(outputFd) < 0 && status == 0)
+        {
+            fprintf(stderr, "sortfile: %s: %s\n", outputPath, strerror(errno));
+            status = -1;
+        }
+    }
+    pool_destroy(pool);
+    return status < 0 ? 1 : 0;
+}
@@ -0,0 +1,23 @@
+#include "ssort.h"
+#include "gsort.h"
+#include "partition.h"
+
+// The int32 instantiation of gsort_impl.h. Buckets and small arrays go to
+// sequential_quicksort(), so they get the chosen partition kernel, the
+// sorting networks and the introsort guard like every other int engine.
+static void sort_bucket_keys(int32_t *array, ptrdiff_t size)
+{
+    if (size > 1)
+        sequential_quicksort(array, 0, size - 1);
+}
+
+#define GSORT_SUFFIX int32
+#define GSORT_TYPE int32_t
+#define GSORT_LESS(a, b) ((a) < (b))
+#define GSORT_LEAF sort_bucket_keys
+#include "gsort_impl.h"
+
+void pool_sample_sort(SortPool *pool, int *array, ptrdiff_t size)
+{
+    gsort_int32(pool, array, size);
+}
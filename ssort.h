@@ -0,0 +1,14 @@
+#ifndef SSORT_H
+#define SSORT_H
+
+#include "pool.h"
+
+// Parallel sample sort. Splitters come from an oversampled random sample; all
+// workers then classify their share of the array into buckets in one pass,
+// scatter it with per-worker histogram prefix sums, and the buckets are sorted
+// independently. Every worker is busy from the first pass on, instead of after
+// log2(P) levels of recursive splitting. Needs a temporary copy of the array.
+// This is gsort_int32() (gsort.h), whose instantiation lives in ssort.c.
+void pool_sample_sort(SortPool *pool, int *array, ptrdiff_t size);
+
+#endif
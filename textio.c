@@ -0,0 +1,394 @@
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#include "textio.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define TEXT_X86 1
+#include <immintrin.h>
+#else
+#define TEXT_X86 0
+#endif
+
+#define TEXT_BLOCK 64               // Bytes classified at once, one bit each
+#define TEXT_CHUNK_MIN (1 << 16)    // Smallest chunk of text or keys given to a worker
+#define TEXT_PARTS_PER_WORKER 4     // Chunks per worker, so a slow chunk does not hold up the rest
+
+enum
+{
+    BYTE_INVALID,
+    BYTE_TOKEN,    // Digit or '-'
+    BYTE_SEPARATOR // ',', '\n', '\r', ' ' or '\t'
+};
+
+static unsigned char byteClass[256];
+
+// Bit i of *token is set if p[i] is part of a key, bit i of *invalid if it is
+// neither part of a key nor a separator
+typedef void (*ClassifyBlock)(const char *p, uint64_t *token, uint64_t *invalid);
+
+static void classify_scalar(const char *p, uint64_t *token, uint64_t *invalid)
+{
+    uint64_t t = 0, bad = 0;
+    for (int i = 0; i < TEXT_BLOCK; i++)
+    {
+        int c = byteClass[(unsigned char)p[i]];
+        t |= (uint64_t)(c == BYTE_TOKEN) << i;
+        bad |= (uint64_t)(c == BYTE_INVALID) << i;
+    }
+    *token = t;
+    *invalid = bad;
+}
+
+#if TEXT_X86
+__attribute__((target("avx2"))) static void classify_avx2(const char *p, uint64_t *token, uint64_t *invalid)
+{
+    uint64_t t = 0, valid = 0;
+    for (int half = 0; half < 2; half++)
+    {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + 32 * half));
+        // c - '0' <= 9 unsigned is a digit
+        __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('0'));
+        __m256i digit = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+        __m256i key = _mm256_or_si256(digit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('-')));
+        __m256i separator = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t')))));
+        uint64_t keyBits = (uint32_t)_mm256_movemask_epi8(key);
+        uint64_t validBits = (uint32_t)_mm256_movemask_epi8(_mm256_or_si256(key, separator));
+        t |= keyBits << (32 * half);
+        valid |= validBits << (32 * half);
+    }
+    *token = t;
+    *invalid = ~valid;
+}
+#endif
+
+static ClassifyBlock classifyBlock = classify_scalar;
+static pthread_once_t textOnce = PTHREAD_ONCE_INIT;
+
+static void text_init(void)
+{
+    for (int c = '0'; c <= '9'; c++)
+        byteClass[c] = BYTE_TOKEN;
+    byteClass['-'] = BYTE_TOKEN;
+    byteClass[','] = byteClass['\n'] = byteClass['\r'] = byteClass[' '] = byteClass['\t'] = BYTE_SEPARATOR;
+#if TEXT_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        classifyBlock = classify_avx2;
+#endif
+}
+
+// Chunk count for work of this size: enough for every worker to steal a few
+static int part_count(SortPool *pool, size_t work)
+{
+    size_t parts = pool != NULL ? (size_t)pool_size(pool) * TEXT_PARTS_PER_WORKER : 1;
+    if (parts > work / TEXT_CHUNK_MIN + 1)
+        parts = work / TEXT_CHUNK_MIN + 1;
+    return (int)parts;
+}
+
+static void for_each_part(SortPool *pool, int parts, void (*run)(void *arg, int part), void *arg)
+{
+    if (pool != NULL)
+        pool_parallel_for(pool, parts, run, arg);
+    else
+    {
+        for (int part = 0; part < parts; part++)
+            run(arg, part);
+    }
+}
+
+typedef struct
+{
+    const char *text;
+    size_t *bounds;     // Chunk part is text[bounds[part]..bounds[part+1]-1]
+    ptrdiff_t *offsets; // Keys before chunk part; its key count until the prefix sum
+    int *errors;        // errno of each chunk, 0 if it parsed
+    int *keys;
+} ParseShared;
+
+// Classify the block at p, padding a short tail with separators
+static void classify(const char *p, size_t left, uint64_t *token, uint64_t *invalid)
+{
+    if (left >= TEXT_BLOCK)
+    {
+        classifyBlock(p, token, invalid);
+        return;
+    }
+    char tail[TEXT_BLOCK];
+    memcpy(tail, p, left);
+    memset(tail + left, '\n', TEXT_BLOCK - left);
+    classifyBlock(tail, token, invalid);
+}
+
+// A key starts at every token byte that follows a separator. Chunks start
+// after a separator, so nothing carries into the first block.
+static void count_part(void *arg, int part)
+{
+    ParseShared *shared = (ParseShared *)arg;
+    size_t begin = shared->bounds[part], end = shared->bounds[part + 1];
+    ptrdiff_t count = 0;
+    uint64_t carry = 0;
+    for (size_t at = begin; at < end; at += TEXT_BLOCK)
+    {
+        uint64_t token, invalid;
+        classify(shared->text + at, end - at, &token, &invalid);
+        if (invalid != 0)
+        {
+            shared->errors[part] = EINVAL;
+            return;
+        }
+        count += __builtin_popcountll(token & ~(token << 1 | carry));
+        carry = token >> 63;
+    }
+    shared->offsets[part] = count;
+}
+
+// Convert the key at text[*at..], which ends before end; returns an errno
+static int parse_key(const char *text, size_t *at, size_t end, int *key)
+{
+    size_t i = *at;
+    int negative = text[i] == '-';
+    i += negative;
+    size_t digits = i;
+    uint64_t value = 0;
+    while (i < end && (unsigned)(text[i] - '0') < 10)
+    {
+        value = value * 10 + (unsigned)(text[i] - '0');
+        if (value > (uint64_t)1 << 31)
+            return ERANGE;
+        i++;
+    }
+    if (i == digits || (i < end && text[i] == '-'))
+        return EINVAL;
+    if (!negative && value > (uint64_t)INT32_MAX)
+        return ERANGE;
+    *key = negative ? (int)(0 - (uint32_t)value) : (int)value;
+    *at = i;
+    return 0;
+}
+
+static void parse_part(void *arg, int part)
+{
+    ParseShared *shared = (ParseShared *)arg;
+    size_t begin = shared->bounds[part], end = shared->bounds[part + 1];
+    int *out = shared->keys + shared->offsets[part];
+    uint64_t carry = 0;
+    for (size_t at = begin; at < end; at += TEXT_BLOCK)
+    {
+        uint64_t token, invalid;
+        classify(shared->text + at, end - at, &token, &invalid);
+        uint64_t starts = token & ~(token << 1 | carry);
+        carry = token >> 63;
+        while (starts != 0)
+        {
+            size_t position = at + (size_t)__builtin_ctzll(starts);
+            starts &= starts - 1;
+            int error = parse_key(shared->text, &position, end, out);
+            if (error != 0)
+            {
+                shared->errors[part] = error;
+                return;
+            }
+            out++;
+        }
+    }
+}
+
+static int first_error(const int *errors, int parts)
+{
+    for (int part = 0; part < parts; part++)
+    {
+        if (errors[part] != 0)
+            return errors[part];
+    }
+    return 0;
+}
+
+ptrdiff_t parse_ints(SortPool *pool, const char *text, size_t length, int **keys)
+{
+    pthread_once(&textOnce, text_init);
+    *keys = NULL;
+
+    int parts = part_count(pool, length);
+    ParseShared shared;
+    shared.text = text;
+    shared.bounds = (size_t *)malloc((parts + 1) * sizeof(size_t));
+    shared.offsets = (ptrdiff_t *)calloc(parts + 1, sizeof(ptrdiff_t));
+    shared.errors = (int *)calloc(parts, sizeof(int));
+    shared.keys = NULL;
+    ptrdiff_t count = -1;
+    int error = ENOMEM;
+    if (shared.bounds == NULL || shared.offsets == NULL || shared.errors == NULL)
+        goto done;
+
+    // Move every cut forward to a separator so no key straddles two chunks
+    shared.bounds[0] = 0;
+    for (int part = 1; part <= parts; part++)
+    {
+        size_t at = length / parts * part + length % parts * part / parts;
+        if (at < shared.bounds[part - 1])
+            at = shared.bounds[part - 1];
+        while (at < length && byteClass[(unsigned char)text[at]] == BYTE_TOKEN)
+            at++;
+        shared.bounds[part] = at;
+    }
+
+    for_each_part(pool, parts, count_part, &shared);
+    if ((error = first_error(shared.errors, parts)) != 0)
+        goto done;
+    ptrdiff_t total = 0;
+    for (int part = 0; part <= parts; part++)
+    {
+        ptrdiff_t keysInPart = shared.offsets[part];
+        shared.offsets[part] = total;
+        total += keysInPart;
+    }
+    if (total == 0)
+    {
+        count = 0;
+        goto done;
+    }
+
+    shared.keys = (int *)malloc((size_t)total * sizeof(int));
+    error = ENOMEM;
+    if (shared.keys == NULL)
+        goto done;
+    for_each_part(pool, parts, parse_part, &shared);
+    if ((error = first_error(shared.errors, parts)) != 0)
+    {
+        free(shared.keys);
+        goto done;
+    }
+    *keys = shared.keys;
+    count = total;
+
+done:
+    free(shared.bounds);
+    free(shared.offsets);
+    free(shared.errors);
+    if (count < 0)
+        errno = error;
+    return count;
+}
+
+// "00" to "99", so the formatter writes two digits per division
+static const char digitPairs[201] = "00010203040506070809"
+                                    "10111213141516171819"
+                                    "20212223242526272829"
+                                    "30313233343536373839"
+                                    "40414243444546474849"
+                                    "50515253545556575859"
+                                    "60616263646566676869"
+                                    "70717273747576777879"
+                                    "80818283848586878889"
+                                    "90919293949596979899";
+
+static int digit_count(uint32_t value)
+{
+    return 1 + (value >= 10) + (value >= 100) + (value >= 1000) + (value >= 10000) + (value >= 100000) +
+           (value >= 1000000) + (value >= 10000000) + (value >= 100000000) + (value >= 1000000000);
+}
+
+static uint32_t magnitude(int key)
+{
+    return key < 0 ? 0 - (uint32_t)key : (uint32_t)key;
+}
+
+typedef struct
+{
+    const int *keys;
+    ptrdiff_t size;
+    int parts;
+    char delimiter;
+    size_t *offsets; // Bytes before chunk part; its length until the prefix sum
+    char *text;
+} FormatShared;
+
+static ptrdiff_t format_start(FormatShared *shared, int part)
+{
+    return shared->size * part / shared->parts;
+}
+
+static void measure_part(void *arg, int part)
+{
+    FormatShared *shared = (FormatShared *)arg;
+    ptrdiff_t end = format_start(shared, part + 1);
+    size_t bytes = 0;
+    for (ptrdiff_t i = format_start(shared, part); i < end; i++)
+        bytes += (size_t)digit_count(magnitude(shared->keys[i])) + (shared->keys[i] < 0) + 1;
+    shared->offsets[part] = bytes;
+}
+
+// Digits are written back to front from the key's known length, two at a time
+static void write_part(void *arg, int part)
+{
+    FormatShared *shared = (FormatShared *)arg;
+    ptrdiff_t end = format_start(shared, part + 1);
+    char *out = shared->text + shared->offsets[part];
+    for (ptrdiff_t i = format_start(shared, part); i < end; i++)
+    {
+        int key = shared->keys[i];
+        uint32_t value = magnitude(key);
+        if (key < 0)
+            *out++ = '-';
+        out += digit_count(value);
+        char *p = out;
+        while (value >= 100)
+        {
+            uint32_t pair = value % 100;
+            value /= 100;
+            p -= 2;
+            memcpy(p, digitPairs + 2 * pair, 2);
+        }
+        if (value >= 10)
+        {
+            p -= 2;
+            memcpy(p, digitPairs + 2 * value, 2);
+        }
+        else
+        {
+            *--p = (char)('0' + value);
+        }
+        *out++ = shared->delimiter;
+    }
+}
+
+char *format_ints(SortPool *pool, const int *keys, ptrdiff_t size, char delimiter, size_t *length)
+{
+    FormatShared shared;
+    shared.keys = keys;
+    shared.size = size > 0 ? size : 0;
+    shared.parts = part_count(pool, (size_t)shared.size);
+    shared.delimiter = delimiter;
+    shared.offsets = (size_t *)calloc(shared.parts + 1, sizeof(size_t));
+    if (shared.offsets == NULL)
+        return NULL;
+
+    for_each_part(pool, shared.parts, measure_part, &shared);
+    size_t total = 0;
+    for (int part = 0; part <= shared.parts; part++)
+    {
+        size_t bytes = shared.offsets[part];
+        shared.offsets[part] = total;
+        total += bytes;
+    }
+
+    shared.text = (char *)malloc(total > 0 ? total : 1);
+    if (shared.text != NULL)
+    {
+        for_each_part(pool, shared.parts, write_part, &shared);
+        if (total > 0)
+            shared.text[total - 1] = '\n';
+        *length = total;
+    }
+    free(shared.offsets);
+    return shared.text;
+}
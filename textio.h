@@ -0,0 +1,27 @@
+#ifndef TEXTIO_H
+#define TEXTIO_H
+
+#include <stddef.h>
+
+#include "pool.h"
+
+// Decimal int text in and out, at memory bandwidth instead of strtok/atoi and
+// one printf per key. The text is cut into chunks at separators and every chunk
+// is handled by one pool worker. The parser classifies 64 bytes at a time
+// (AVX2 where the CPU has it), so runs of separators are skipped a word at a
+// time, and counts the keys before it parses them so each chunk writes
+// straight to its place in the output. pool may be NULL to run in the caller.
+
+// Parse the integers in text[0..length-1]. Keys are an optional '-' and
+// decimal digits; they are separated by any run of ',', '\n', '\r', ' ' or
+// '\t'. On success *keys is a malloc()ed array (NULL if there are none) and the
+// number of keys is returned. Returns -1 with errno EINVAL for any other byte
+// or a malformed key, ERANGE for a key outside int, or ENOMEM.
+ptrdiff_t parse_ints(SortPool *pool, const char *text, size_t length, int **keys);
+
+// Format keys as decimal text, delimiter after each key but the last and a
+// newline after that. Returns a malloc()ed buffer and its length in *length,
+// or NULL if it does not fit in memory. An empty array gives an empty text.
+char *format_ints(SortPool *pool, const int *keys, ptrdiff_t size, char delimiter, size_t *length);
+
+#endif
@@ -0,0 +1,150 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "tune.h"
+#include "pool.h"
+#include "partition.h"
+#include "gen.h"
+
+#define TUNE_REPS 3         // Timed runs per candidate; the median counts
+#define TUNE_TOLERANCE 1.02 // Prefer fewer threads unless more are over 2% faster
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Median time of TUNE_REPS sorts of the same input; pool NULL means sequential
+static double time_sort(SortPool *pool, int *array, ptrdiff_t size)
+{
+    GenOptions gen;
+    gen_default_options(&gen);
+    double times[TUNE_REPS];
+    for (int r = 0; r < TUNE_REPS; r++)
+    {
+        generate_input(array, size, &gen);
+        double start = now();
+        if (pool != NULL)
+            pool_sort(pool, array, size);
+        else
+            sequential_quicksort(array, 0, size - 1);
+        times[r] = now() - start;
+    }
+    for (int i = 1; i < TUNE_REPS; i++)
+    {
+        for (int j = i; j > 0 && times[j - 1] > times[j]; j--)
+        {
+            double t = times[j];
+            times[j] = times[j - 1];
+            times[j - 1] = t;
+        }
+    }
+    return times[TUNE_REPS / 2];
+}
+
+int autotune(SortProfile *profile, const ptrdiff_t *sizes, int sizeCount, FILE *log)
+{
+    static const int leafCandidates[] = {8, 12, 16, 24, 32, 48, 64};
+    static const int thresholdCandidates[] = {1 << 10, 1 << 12, 1 << 14, 1 << 16, 1 << 18, 1 << 20};
+    int leafCount = sizeof(leafCandidates) / sizeof(leafCandidates[0]);
+    int thresholdCount = sizeof(thresholdCandidates) / sizeof(thresholdCandidates[0]);
+
+    // Load any existing profile now so it cannot override the candidates later
+    host_profile();
+
+    ptrdiff_t smallest = sizes[0], largest = sizes[0];
+    for (int s = 1; s < sizeCount; s++)
+    {
+        if (sizes[s] < smallest)
+            smallest = sizes[s];
+        if (sizes[s] > largest)
+            largest = sizes[s];
+    }
+    int *array = (int *)malloc((size_t)largest * sizeof(int));
+    if (array == NULL)
+    {
+        if (log != NULL)
+            fprintf(log, "cannot allocate %td keys\n", largest);
+        return -1;
+    }
+
+    // Leaf size of the sequential sort
+    double best = 0;
+    for (int c = 0; c < leafCount; c++)
+    {
+        smallThreshold = leafCandidates[c];
+        double t = time_sort(NULL, array, smallest);
+        if (log != NULL)
+            fprintf(log, "small_threshold %d: %f s\n", smallThreshold, t);
+        if (c == 0 || t < best)
+        {
+            best = t;
+            profile->smallThreshold = smallThreshold;
+        }
+    }
+    smallThreshold = profile->smallThreshold;
+
+    // Thread count: powers of two up to the core count, and the core count itself
+    int cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores < 1)
+        cores = 1;
+    best = 0;
+    int threads = 1;
+    while (1)
+    {
+        SortPool *pool = pool_create(threads);
+        if (pool == NULL)
+        {
+            if (log != NULL)
+                fprintf(log, "cannot start %d threads\n", threads);
+            free(array);
+            return -1;
+        }
+        double t = time_sort(pool, array, largest);
+        pool_destroy(pool);
+        if (log != NULL)
+            fprintf(log, "threads %d: %f s\n", threads, t);
+        if (threads == 1 || t * TUNE_TOLERANCE < best)
+        {
+            best = t;
+            profile->threads = threads;
+        }
+        if (threads == cores)
+            break;
+        threads = threads * 2 < cores ? threads * 2 : cores;
+    }
+
+    // Pool threshold over every size
+    SortPool *pool = pool_create(profile->threads);
+    if (pool == NULL)
+    {
+        if (log != NULL)
+            fprintf(log, "cannot start %d threads\n", profile->threads);
+        free(array);
+        return -1;
+    }
+    best = 0;
+    for (int c = 0; c < thresholdCount; c++)
+    {
+        pool_set_threshold(pool, thresholdCandidates[c]);
+        double t = 0;
+        for (int s = 0; s < sizeCount; s++)
+            t += time_sort(pool, array, sizes[s]);
+        if (log != NULL)
+            fprintf(log, "pool_threshold %d: %f s\n", thresholdCandidates[c], t);
+        if (c == 0 || t < best)
+        {
+            best = t;
+            profile->poolThreshold = thresholdCandidates[c];
+        }
+    }
+    pool_destroy(pool);
+    free(array);
+    return 0;
+}
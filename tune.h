@@ -0,0 +1,16 @@
+#ifndef TUNE_H
+#define TUNE_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "profile.h"
+
+// Calibrate this host: the leaf size of the sequential sort on the smallest of
+// sizes[], the thread count on the largest, and the pool threshold summed over
+// all of them. Uniform random input, a few repetitions per candidate.
+// Progress goes to log (may be NULL). Returns 0, or -1 if the keys cannot be
+// allocated or a pool cannot be started.
+int autotune(SortProfile *profile, const ptrdiff_t *sizes, int sizeCount, FILE *log);
+
+#endif
@@ -0,0 +1,144 @@
+#include <stdlib.h>
+
+#include "verify.h"
+
+#define VERIFY_CHUNK_MIN (1 << 16)  // Smallest chunk of keys given to a worker
+#define VERIFY_PARTS_PER_WORKER 4   // Chunks per worker, so a slow chunk does not hold up the rest
+#define VERIFY_MAX_PARTS 1024       // Chunk results live on the caller's stack
+
+// splitmix64's finalizer: every input bit flips about half of the output bits
+static inline uint64_t mix(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+typedef struct
+{
+    uint64_t sum;
+    uint64_t xor;
+    ptrdiff_t descent; // First descent in the chunk, -1 if none
+} PartResult;
+
+typedef struct
+{
+    const int *keys;
+    ptrdiff_t size;
+    int parts;
+    int hash;   // Compute the hash
+    int sorted; // Look for a descent
+    PartResult results[VERIFY_MAX_PARTS];
+} VerifyShared;
+
+static ptrdiff_t part_start(VerifyShared *shared, int part)
+{
+    return shared->size * part / shared->parts;
+}
+
+// Each chunk also compares its first key with the last key of the chunk before
+static void verify_part(void *arg, int part)
+{
+    VerifyShared *shared = (VerifyShared *)arg;
+    const int *keys = shared->keys;
+    ptrdiff_t begin = part_start(shared, part), end = part_start(shared, part + 1);
+    PartResult *result = &shared->results[part];
+    uint64_t sum = 0, xor = 0;
+    if (shared->hash)
+    {
+        for (ptrdiff_t i = begin; i < end; i++)
+        {
+            uint64_t key = (uint32_t)keys[i];
+            sum += mix(key);
+            xor ^= mix(key + 0x9e3779b97f4a7c15ULL);
+        }
+    }
+    result->sum = sum;
+    result->xor = xor;
+    result->descent = -1;
+    if (shared->sorted)
+    {
+        // No early exit inside the loop, so it vectorizes; the chunk is rescanned only on failure
+        int descents = 0;
+        for (ptrdiff_t i = begin > 0 ? begin : 1; i < end; i++)
+            descents |= keys[i - 1] > keys[i];
+        if (descents)
+        {
+            for (ptrdiff_t i = begin > 0 ? begin : 1; result->descent < 0; i++)
+            {
+                if (keys[i - 1] > keys[i])
+                    result->descent = i - 1;
+            }
+        }
+    }
+}
+
+// One pass over keys; returns the first descent if asked to look for one
+static ptrdiff_t verify_pass(SortPool *pool, const int *keys, ptrdiff_t size, KeyHash *hash, int sorted)
+{
+    VerifyShared shared;
+    shared.keys = keys;
+    shared.size = size > 0 ? size : 0;
+    shared.hash = hash != NULL;
+    shared.sorted = sorted;
+    ptrdiff_t parts = pool != NULL ? (ptrdiff_t)pool_size(pool) * VERIFY_PARTS_PER_WORKER : 1;
+    if (parts > shared.size / VERIFY_CHUNK_MIN + 1)
+        parts = shared.size / VERIFY_CHUNK_MIN + 1;
+    if (parts > VERIFY_MAX_PARTS)
+        parts = VERIFY_MAX_PARTS;
+    shared.parts = (int)parts;
+
+    if (pool != NULL && shared.parts > 1)
+        pool_parallel_for(pool, shared.parts, verify_part, &shared);
+    else
+    {
+        for (int part = 0; part < shared.parts; part++)
+            verify_part(&shared, part);
+    }
+
+    ptrdiff_t descent = -1;
+    uint64_t sum = 0, xor = 0;
+    for (int part = 0; part < shared.parts; part++)
+    {
+        sum += shared.results[part].sum;
+        xor ^= shared.results[part].xor;
+        if (descent < 0)
+            descent = shared.results[part].descent;
+    }
+    if (hash != NULL)
+    {
+        hash->sum = sum;
+        hash->xor = xor;
+        hash->count = shared.size;
+    }
+    return descent;
+}
+
+void key_hash(SortPool *pool, const int *keys, ptrdiff_t size, KeyHash *hash)
+{
+    verify_pass(pool, keys, size, hash, 0);
+}
+
+int key_hash_equal(const KeyHash *a, const KeyHash *b)
+{
+    return a->sum == b->sum && a->xor == b->xor && a->count == b->count;
+}
+
+ptrdiff_t find_unsorted(SortPool *pool, const int *keys, ptrdiff_t size)
+{
+    return verify_pass(pool, keys, size, NULL, 1);
+}
+
+VerifyResult verify_sort(SortPool *pool, const KeyHash *input, const int *output, ptrdiff_t size, ptrdiff_t *where)
+{
+    KeyHash hash;
+    ptrdiff_t descent = verify_pass(pool, output, size, &hash, 1);
+    if (where != NULL)
+        *where = descent;
+    if (descent >= 0)
+        return VERIFY_UNSORTED;
+    return key_hash_equal(input, &hash) ? VERIFY_OK : VERIFY_NOT_PERMUTATION;
+}
@@ -0,0 +1,42 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pool.h"
+
+// Sort verification in one parallel pass, with no copy and no second sort.
+// A permutation is detected with an order-independent multiset hash: every
+// key goes through two 64-bit mixers, and the sum of one and the xor of the
+// other are taken per chunk and combined. Both are unchanged by reordering,
+// so the input is hashed before the sort and compared with the output's hash.
+// A lost, duplicated or changed key gets through only on a 64-bit collision.
+// pool may be NULL to run in the caller.
+
+typedef struct
+{
+    uint64_t sum;    // Sum of the first mixer over the keys, mod 2^64
+    uint64_t xor;    // Xor of the second mixer over the keys
+    ptrdiff_t count; // Number of keys
+} KeyHash;
+
+void key_hash(SortPool *pool, const int *keys, ptrdiff_t size, KeyHash *hash);
+
+int key_hash_equal(const KeyHash *a, const KeyHash *b);
+
+// First i with keys[i] > keys[i + 1], or -1 if keys[0..size-1] is non-decreasing
+ptrdiff_t find_unsorted(SortPool *pool, const int *keys, ptrdiff_t size);
+
+typedef enum
+{
+    VERIFY_OK,
+    VERIFY_UNSORTED,        // *where is the first descent
+    VERIFY_NOT_PERMUTATION, // Sorted, but not the input's keys
+} VerifyResult;
+
+// Check that output[0..size-1] is non-decreasing and has the keys input was
+// hashed from. where may be NULL.
+VerifyResult verify_sort(SortPool *pool, const KeyHash *input, const int *output, ptrdiff_t size, ptrdiff_t *where);
+
+#endif
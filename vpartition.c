@@ -0,0 +1,239 @@
+#include <limits.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "partition.h"
+#include "vpartition.h"
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#define VECTOR_X86 1
+#include <immintrin.h>
+#else
+#define VECTOR_X86 0
+#endif
+
+// Lopsided splits with less than 1/LOPSIDED_SPLIT of the range on the left get a
+// second pass that pulls the keys equal to the pivot out of the right side
+#define LOPSIDED_SPLIT 16
+
+// Partition [begin, end) so that [begin, split) < bound <= [split, end); returns split
+typedef int *(*VectorPass)(int *begin, int *end, int bound);
+
+static int *pass_scalar(int *begin, int *end, int bound)
+{
+    int *i = begin, *j = end - 1;
+    while (1)
+    {
+        while (i <= j && *i < bound)
+            i++;
+        while (i <= j && *j >= bound)
+            j--;
+        if (i >= j)
+            break;
+        swap(i, j);
+        i++;
+        j--;
+    }
+    return i;
+}
+
+#if VECTOR_X86
+// The in-place vector passes follow Bramas' AVX-512 quicksort. One vector from
+// each end is held in registers, so there is always room for a full store at both
+// write cursors. Each step reads the next vector from the side with less free
+// room, then stores it twice: once with the small keys packed to the front at
+// the left cursor and once with the large keys packed to the back at the right
+// cursor. Each cursor moves past only its own keys, so the junk lanes of one
+// store are overwritten by later ones.
+
+// AVX2 has no compress-store: compressTable[mask] is the permutation that moves
+// the lanes set in mask to the front, keeping the order of both groups
+static int compressTable[256][8] __attribute__((aligned(32)));
+
+static void build_compress_table(void)
+{
+    for (int mask = 0; mask < 256; mask++)
+    {
+        int n = 0;
+        for (int lane = 0; lane < 8; lane++)
+        {
+            if (mask & (1 << lane))
+                compressTable[mask][n++] = lane;
+        }
+        for (int lane = 0; lane < 8; lane++)
+        {
+            if (!(mask & (1 << lane)))
+                compressTable[mask][n++] = lane;
+        }
+    }
+}
+
+__attribute__((target("avx2"))) static inline void store_avx2(__m256i v, __m256i bound, int **left, int **right)
+{
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(bound, v)));
+    int count = __builtin_popcount(mask);
+    v = _mm256_permutevar8x32_epi32(v, _mm256_load_si256((const __m256i *)compressTable[mask]));
+    _mm256_storeu_si256((__m256i *)*left, v);
+    _mm256_storeu_si256((__m256i *)(*right - 8), v);
+    *left += count;
+    *right -= 8 - count;
+}
+
+__attribute__((target("avx2"))) static int *pass_avx2(int *begin, int *end, int bound)
+{
+    if (end - begin < 16)
+        return pass_scalar(begin, end, bound);
+
+    __m256i b = _mm256_set1_epi32(bound);
+    __m256i first = _mm256_loadu_si256((const __m256i *)begin);
+    __m256i last = _mm256_loadu_si256((const __m256i *)(end - 8));
+    int *left = begin, *right = end;                // Write cursors
+    int *readLeft = begin + 8, *readRight = end - 8; // [readLeft, readRight) not read yet
+
+    while (readRight - readLeft >= 8)
+    {
+        __m256i v;
+        if (readLeft - left <= right - readRight)
+        {
+            v = _mm256_loadu_si256((const __m256i *)readLeft);
+            readLeft += 8;
+        }
+        else
+        {
+            readRight -= 8;
+            v = _mm256_loadu_si256((const __m256i *)readRight);
+        }
+        store_avx2(v, b, &left, &right);
+    }
+
+    // Copy the last few unread keys out first, the scalar writes may cover them
+    int rest[8];
+    int restCount = (int)(readRight - readLeft);
+    memcpy(rest, readLeft, restCount * sizeof(int));
+    for (int k = 0; k < restCount; k++)
+    {
+        if (rest[k] < bound)
+            *left++ = rest[k];
+        else
+            *--right = rest[k];
+    }
+
+    // Exactly 16 free slots are left for the two held vectors
+    store_avx2(first, b, &left, &right);
+    store_avx2(last, b, &left, &right);
+    return left;
+}
+
+__attribute__((target("avx512f"))) static inline void store_avx512(__m512i v, __m512i bound, int **left,
+                                                                  int **right)
+{
+    __mmask16 mask = _mm512_cmplt_epi32_mask(v, bound);
+    int count = __builtin_popcount(mask);
+    _mm512_mask_compressstoreu_epi32(*left, mask, v);
+    _mm512_mask_compressstoreu_epi32(*right - (16 - count), (__mmask16)~mask, v);
+    *left += count;
+    *right -= 16 - count;
+}
+
+__attribute__((target("avx512f"))) static int *pass_avx512(int *begin, int *end, int bound)
+{
+    if (end - begin < 32)
+        return pass_scalar(begin, end, bound);
+
+    __m512i b = _mm512_set1_epi32(bound);
+    __m512i first = _mm512_loadu_si512(begin);
+    __m512i last = _mm512_loadu_si512(end - 16);
+    int *left = begin, *right = end;
+    int *readLeft = begin + 16, *readRight = end - 16;
+
+    while (readRight - readLeft >= 16)
+    {
+        __m512i v;
+        if (readLeft - left <= right - readRight)
+        {
+            v = _mm512_loadu_si512(readLeft);
+            readLeft += 16;
+        }
+        else
+        {
+            readRight -= 16;
+            v = _mm512_loadu_si512(readRight);
+        }
+        store_avx512(v, b, &left, &right);
+    }
+
+    int rest[16];
+    int restCount = (int)(readRight - readLeft);
+    memcpy(rest, readLeft, restCount * sizeof(int));
+    for (int k = 0; k < restCount; k++)
+    {
+        if (rest[k] < bound)
+            *left++ = rest[k];
+        else
+            *--right = rest[k];
+    }
+
+    store_avx512(first, b, &left, &right);
+    store_avx512(last, b, &left, &right);
+    return left;
+}
+#endif
+
+static VectorPass vectorPass = pass_scalar;
+static const char *vectorIsa = "scalar";
+static pthread_once_t dispatchOnce = PTHREAD_ONCE_INIT;
+
+// Pick the widest instruction set this CPU supports, once per process
+static void select_isa(void)
+{
+#if VECTOR_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+    {
+        vectorPass = pass_avx512;
+        vectorIsa = "avx512";
+    }
+    else if (__builtin_cpu_supports("avx2"))
+    {
+        build_compress_table();
+        vectorPass = pass_avx2;
+        vectorIsa = "avx2";
+    }
+#endif
+}
+
+const char *partition_vector_isa(void)
+{
+    pthread_once(&dispatchOnce, select_isa);
+    return vectorIsa;
+}
+
+void partition_vector(int *arr, ptrdiff_t low, ptrdiff_t high, ptrdiff_t *leftEnd, ptrdiff_t *rightStart)
+{
+    pthread_once(&dispatchOnce, select_isa);
+
+    swap(&arr[low], &arr[choose_pivot(arr, low, high)]);
+    int pivot = arr[low];
+    ptrdiff_t size = high - low + 1;
+
+    // arr[low+1..split-1] < pivot <= arr[split..high], then the pivot goes in between
+    ptrdiff_t split = vectorPass(arr + low + 1, arr + high + 1, pivot) - arr;
+    swap(&arr[low], &arr[split - 1]);
+    ptrdiff_t leftSize = split - 1 - low;
+    ptrdiff_t equalEnd = split;
+
+    // With many keys equal to the pivot the strict split leaves the left side
+    // (nearly) empty; a <= pass over the right side takes them out of play
+    if (leftSize < size / LOPSIDED_SPLIT)
+    {
+        if (pivot == INT_MAX)
+            equalEnd = high + 1;
+        else
+            equalEnd = vectorPass(arr + split, arr + high + 1, pivot + 1) - arr;
+    }
+
+    if (splitStatsEnabled && size >= SPLIT_STATS_MIN)
+        record_split(size, leftSize);
+    *leftEnd = split - 2;
+    *rightStart = equalEnd;
+}
@@ -0,0 +1,19 @@
+#ifndef VPARTITION_H
+#define VPARTITION_H
+
+#include <stddef.h>
+
+// Vectorized partition: compares 16 (AVX-512) or 8 (AVX2) keys at a time against
+// a broadcast pivot and compress-stores them to the left and right write cursors.
+// The instruction set is picked once from CPUID; other CPUs and non-x86 builds
+// run the same algorithm one element at a time.
+//
+// Partitions arr[low..high] around the pivot from choose_pivot(). Afterwards
+// arr[low..*leftEnd] < pivot <= arr[*rightStart..high] and everything in
+// between equals the pivot and is final, like partition_three_way().
+void partition_vector(int *arr, ptrdiff_t low, ptrdiff_t high, ptrdiff_t *leftEnd, ptrdiff_t *rightStart);
+
+// Instruction set partition_vector() runs on: "avx512", "avx2" or "scalar"
+const char *partition_vector_isa(void);
+
+#endif